@@ -26,7 +26,27 @@ uint32_t veces_mensaje = 0;
 /*
  * Constantes relativas a la aplicacion
  */
-uint32_t const delay = 0x10000;
+uint32_t const delay = 250;		// Milisegundos
+uint32_t const green_delay = 400;	// Milisegundos
+
+/*
+ * Tarea que hace parpadear el led verde, a su propio ritmo y con más
+ * prioridad que main
+ */
+#define GREEN_PRIORITY	8
+task_t green_task;
+TASK_STACK(green_stack, 512);
+
+/*
+ * Eventos que atiende main
+ */
+enum{
+	EV_UART_RX = 0,		/* Datos recibidos por la UART1 */
+	EV_RED_TICK			/* Cambio de estado del led rojo */
+};
+
+/* Temporizador del parpadeo del led rojo */
+systimer_t red_timer;
 
 /*****************************************************************************/
 
@@ -62,11 +82,21 @@ void leds_off (uint32_t pin){
 /*****************************************************************************/
 
 /*
- * Retardo para el parpadeo
+ * Parpadeo del led verde, independiente del rojo
+ * @param arg No se usa
  */
-void pause(void){
-	uint32_t i;
-	for (i = 0; i < delay; i++);
+void green_blink(void *arg){
+	while (1){
+		if (green_led){
+			leds_on(GREEN_LED);
+		}
+
+		task_sleep_ms(green_delay);
+
+		leds_off(GREEN_LED);
+
+		task_sleep_ms(green_delay);
+	}
 }
 
 /*****************************************************************************/
@@ -82,6 +112,18 @@ void print_str(char * str){
 /*****************************************************************************/
 
 void my_callback(){
+	/* Los datos se leen en el bucle de eventos, fuera de la interrupción */
+	event_post(EV_UART_RX, 0);
+}
+
+/*****************************************************************************/
+
+/*
+ * Atiende los datos recibidos por la UART1
+ * @param type		No se usa
+ * @param payload	No se usa
+ */
+void uart_rx_handler(uint32_t type, uint32_t payload){
 	uint32_t len;
 	uint32_t i;
 	char c;
@@ -124,6 +166,36 @@ void my_callback(){
 
 /*****************************************************************************/
 
+/*
+ * Función del temporizador del led rojo
+ * @param arg No se usa
+ */
+void red_tick(void *arg){
+	event_post(EV_RED_TICK, 0);
+}
+
+/*****************************************************************************/
+
+/*
+ * Parpadeo del led rojo
+ * @param type		No se usa
+ * @param payload	No se usa
+ */
+void red_blink(uint32_t type, uint32_t payload){
+	static uint32_t on = 1;
+
+	if (on){
+		leds_off(RED_LED);
+		on = 0;
+	}
+	else if (red_led){
+		leds_on(RED_LED);
+		on = 1;
+	}
+}
+
+/*****************************************************************************/
+
 /*
  * Programa principal
  */
@@ -136,26 +208,27 @@ int main (){
 	leds_on(RED_LED);
 	leds_on(GREEN_LED);
 
+	/* Un aluvión de datos recibidos se atiende con una sola lectura */
+	event_register(EV_UART_RX, uart_rx_handler, EVENT_COALESCE);
+	event_register(EV_RED_TICK, red_blink, 0);
+
 	uart_set_receive_callback(uart_1, my_callback);
 
 	iprintf("Hola mundo!\n");
 
-	while (1){
-		if (red_led){
-			leds_on(RED_LED);
-		}
-
-		if (green_led){
-			leds_on(GREEN_LED);
-		}
+	/* Si hubo un fallo antes del último reinicio, lo mostramos */
+	if(excep_get_last_fault()){
+		excep_print_fault(excep_get_last_fault());
+	}
 
-		pause();
+	task_create(&green_task, "green", green_blink, NULL, GREEN_PRIORITY,
+			green_stack, sizeof(green_stack));
 
-		leds_off(RED_LED);
-		leds_off(GREEN_LED);
+	systimer_setup(&red_timer, red_tick, NULL, 0);
+	systimer_start(&red_timer, delay, delay);
 
-		pause();
-	}
+	/* main atiende los eventos y duerme mientras no los hay */
+	event_loop();
 
 	return 0;
 }
@@ -29,6 +29,18 @@ BSP_INCLUDE_DIRS = $(sort $(dir $(shell find $(BSP_ROOT_DIR) -name '*.h' -print)
 BSP_CFLAGS     = $(addprefix -I, $(BSP_INCLUDE_DIRS))
 BSP_ASFLAGS    = $(addprefix -I, $(BSP_INCLUDE_DIRS))
 
+# Instrumentación de las interrupciones del ITC (descomentar para activarla)
+#BSP_CFLAGS     += -DITC_STATS
+
+# Tamaño de la rueda de temporizadores: LEVELS niveles de 2^BITS ranuras
+#BSP_CFLAGS     += -DTIMER_WHEEL_BITS=6 -DTIMER_WHEEL_LEVELS=4
+
+# Clases de los pools de bloques: X(bytes, bloques) en orden creciente
+#BSP_CFLAGS     += '-DPOOL_CLASSES(X)=X(16, 32) X(64, 16) X(256, 8)'
+
+# Atribución de las reservas del heap a su punto de llamada (descomentar para activarla)
+#BSP_CFLAGS     += -DHEAP_DEBUG
+
 # Añadimos la biblioteca generada por el BSP a la lista de bibliotecas
 BSP_LDFLAGS    = -T$(BSP_LINKER_SCRIPT) -L$(BSP_ROOT_DIR)
 BSP_LIBS       = -l$(BSP)
@@ -0,0 +1,209 @@
+/*
+ * Sistemas operativos empotrados
+ * Driver para el módulo de reloj y reset (CRM) del MC1322x
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Acceso estructurado a los registros del CRM
+ */
+typedef struct{
+	volatile uint32_t SYS_CNTL;			// System Control Register
+	volatile uint32_t WU_CNTL;			// Wake-up Control Register
+	volatile uint32_t SLEEP_CNTL;		// Sleep Control Register
+	volatile uint32_t BS_CNTL;			// Bus Stealing Control Register
+	volatile uint32_t COP_CNTL;			// COP Control Register
+	volatile uint32_t COP_SERVICE;		// COP Service Register
+	volatile uint32_t STATUS;			// Status Register
+	volatile uint32_t MOD_STATUS;		// Module Status Register
+	volatile uint32_t WU_COUNT;			// Wake-up Count Register
+	volatile uint32_t WU_TIMEOUT;		// Wake-up Timeout Register
+	volatile uint32_t RTC_COUNT;		// RTC Count Register
+	volatile uint32_t RTC_TIMEOUT;		// RTC Timeout Register
+	const uint32_t RESERVED;
+	volatile uint32_t CAL_CNTL;			// Calibration Control Register
+	volatile uint32_t CAL_COUNT;		// Calibration Count Register
+	volatile uint32_t RINGOSC_CNTL;		// Ring Oscillator Control Register
+	volatile uint32_t XTAL_CNTL;		// Reference Oscillator Control Register
+	volatile uint32_t XTAL32_CNTL;		// 32 kHz Oscillator Control Register
+	volatile uint32_t VREG_CNTL;		// Voltage Regulator Control Register
+	volatile uint32_t VREG_TRIM;		// Voltage Regulator Trim Register
+	volatile uint32_t SW_RST;			// Software Reset Register
+} crm_regs_t;
+
+static volatile crm_regs_t* const crm_regs = CRM_BASE;
+
+/*****************************************************************************/
+
+/**
+ * Campo XTAL_CLKDIV del registro SYS_CNTL: divisor del reloj de referencia
+ */
+#define CRM_SYS_CNTL_XTAL_CLKDIV_SHIFT	8
+#define CRM_SYS_CNTL_XTAL_CLKDIV_MASK	(CRM_MAX_DIV << CRM_SYS_CNTL_XTAL_CLKDIV_SHIFT)
+
+/*****************************************************************************/
+
+/**
+ * Frecuencia actual del reloj del sistema
+ */
+static volatile uint32_t crm_freq;
+
+/**
+ * Funciones registradas para los cambios de frecuencia
+ */
+static crm_clock_notifier_t crm_notifiers[CRM_MAX_NOTIFIERS];
+static uint32_t crm_num_notifiers;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa el driver. El sistema arranca a CPU_FREQ sin dividir
+ */
+void crm_init(){
+	crm_freq = CPU_FREQ;
+	crm_num_notifiers = 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna la frecuencia actual del reloj del sistema, que es también la del
+ * bus de periféricos
+ * @return	Frecuencia en Hz
+ */
+inline uint32_t crm_get_freq(){
+	return crm_freq;
+}
+
+/*****************************************************************************/
+
+/**
+ * Cambia el divisor del reloj del sistema. La frecuencia resultante es
+ * CRM_XTAL_FREQ / (div + 1)
+ * No se puede llamar desde los manejadores de interrupción ni desde una
+ * región crítica: los drivers pueden esperar en la fase previa
+ * @param div	Divisor, entre 0 y CRM_MAX_DIV
+ * @return		Cero en caso de éxito o -1 en caso de error (EBUSY si algún
+ * 				driver rechaza el cambio).
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t crm_set_divider(uint32_t div){
+	uint32_t old_freq, new_freq, i, j, token;
+	int32_t ret = 0;
+
+	if(div > CRM_MAX_DIV){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	new_freq = CRM_XTAL_FREQ / (div + 1);
+	old_freq = crm_freq;
+
+	if(new_freq == old_freq){
+		return 0;
+	}
+
+	/* Fase previa con las interrupciones habilitadas: los drivers pueden */
+	/* esperar a terminar su trabajo sin que se pierdan interrupciones */
+	for(i = 0; i < crm_num_notifiers; i++){
+		if(crm_notifiers[i](crm_clock_pre_change, old_freq, new_freq)){
+			/* Los anteriores deshacen lo que hicieron en la fase previa */
+			for(j = 0; j < i; j++){
+				crm_notifiers[j](crm_clock_abort, old_freq, new_freq);
+			}
+
+			errno = EBUSY;
+
+			return -1;
+		}
+	}
+
+	/* Los drivers se reprograman sin que ninguna interrupción los vea a */
+	/* medias: con todas las fuentes del ITC deshabilitadas sólo durante */
+	/* la escritura del divisor y la reprogramación de los registros */
+	token = itc_critical_enter();
+
+	/* Otra tarea ha cambiado la frecuencia durante la fase previa */
+	if(crm_freq != old_freq){
+		for(i = 0; i < crm_num_notifiers; i++){
+			crm_notifiers[i](crm_clock_abort, old_freq, new_freq);
+		}
+
+		errno = EBUSY;
+		ret = -1;
+	}
+	else{
+		for(i = 0; i < crm_num_notifiers; i++){
+			crm_notifiers[i](crm_clock_switch, old_freq, new_freq);
+		}
+
+		crm_regs->SYS_CNTL = (crm_regs->SYS_CNTL & ~CRM_SYS_CNTL_XTAL_CLKDIV_MASK) |
+				(div << CRM_SYS_CNTL_XTAL_CLKDIV_SHIFT);
+		crm_freq = new_freq;
+
+		for(i = 0; i < crm_num_notifiers; i++){
+			crm_notifiers[i](crm_clock_post_change, old_freq, new_freq);
+		}
+	}
+
+	itc_critical_exit(token);
+
+	return ret;
+}
+
+/*****************************************************************************/
+
+/**
+ * Fija la mayor frecuencia del reloj del sistema que no supera la indicada
+ * No se puede llamar desde los manejadores de interrupción
+ * @param freq	Frecuencia máxima en Hz
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t crm_set_freq(uint32_t freq){
+	if(freq == 0){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	/* Menor divisor tal que CRM_XTAL_FREQ / (div + 1) <= freq */
+	return crm_set_divider((CRM_XTAL_FREQ + freq - 1) / freq - 1);
+}
+
+/*****************************************************************************/
+
+/**
+ * Registra una función para que se le notifiquen los cambios de frecuencia
+ * @param notifier	Función
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t crm_register_notifier(crm_clock_notifier_t notifier){
+	uint32_t token;
+
+	if(notifier == NULL){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	if(crm_num_notifiers >= CRM_MAX_NOTIFIERS){
+		errno = ENOMEM;
+
+		return -1;
+	}
+
+	token = itc_critical_enter();
+	crm_notifiers[crm_num_notifiers++] = notifier;
+	itc_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
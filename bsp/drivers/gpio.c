@@ -4,6 +4,7 @@
  */
 
 #include "system.h"
+#include "reg.h"
 
 /*****************************************************************************/
 
@@ -27,6 +28,12 @@ typedef struct{
 
 static volatile gpio_regs_t* const gpio_regs = GPIO_BASE;
 
+/**
+ * Campo de 2 bits de FUNC_SEL de un pin (16 pines por registro)
+ */
+#define GPIO_FUNC_SEL_SHIFT(pin)	(((pin) & 0xf) << 1)
+#define GPIO_FUNC_SEL_MASK(pin)		REG_MASK(GPIO_FUNC_SEL_SHIFT(pin), 2)
+
 /*****************************************************************************/
 
 /**
@@ -42,7 +49,7 @@ inline gpio_err_t gpio_set_port_dir_input(gpio_port_t port, uint32_t mask){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->PAD_DIR_RESET[port] = mask;
+	REG_WRITE(gpio_regs->PAD_DIR_RESET[port], mask);
 
 	return gpio_no_error;
 }
@@ -62,7 +69,7 @@ inline gpio_err_t gpio_set_port_dir_output(gpio_port_t port, uint32_t mask){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->PAD_DIR_SET[port] = mask;
+	REG_WRITE(gpio_regs->PAD_DIR_SET[port], mask);
 
 	return gpio_no_error;
 }
@@ -81,7 +88,7 @@ inline gpio_err_t gpio_set_pin_dir_input(gpio_pin_t pin){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->PAD_DIR_RESET[(pin >> 5) & 1] = 1 << (pin & 0x1f);
+	REG_WRITE(gpio_regs->PAD_DIR_RESET[(pin >> 5) & 1], REG_BIT(pin & 0x1f));
 
 	return gpio_no_error;
 }
@@ -100,7 +107,7 @@ inline gpio_err_t gpio_set_pin_dir_output(gpio_pin_t pin){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->PAD_DIR_SET[(pin >> 5) & 1] = 1 << (pin & 0x1f);
+	REG_WRITE(gpio_regs->PAD_DIR_SET[(pin >> 5) & 1], REG_BIT(pin & 0x1f));
 
 	return gpio_no_error;
 }
@@ -120,7 +127,7 @@ inline gpio_err_t gpio_set_port(gpio_port_t port, uint32_t mask){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->DATA_SET[port] = mask;
+	REG_WRITE(gpio_regs->DATA_SET[port], mask);
 
 	return gpio_no_error;
 }
@@ -140,7 +147,7 @@ inline gpio_err_t gpio_clear_port(gpio_port_t port, uint32_t mask){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->DATA_RESET[port] = mask;
+	REG_WRITE(gpio_regs->DATA_RESET[port], mask);
 
 	return gpio_no_error;
 }
@@ -159,7 +166,7 @@ inline gpio_err_t gpio_set_pin(gpio_pin_t pin){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->DATA_SET[(pin >> 5) & 1] = 1 << (pin & 0x1f);
+	REG_WRITE(gpio_regs->DATA_SET[(pin >> 5) & 1], REG_BIT(pin & 0x1f));
 
 	return gpio_no_error;
 }
@@ -178,7 +185,7 @@ inline gpio_err_t gpio_clear_pin(gpio_pin_t pin){
 		return gpio_invalid_parameter;
 	}
 
-	gpio_regs->DATA_RESET[(pin >> 5) & 1] = 1 << (pin & 0x1f);
+	REG_WRITE(gpio_regs->DATA_RESET[(pin >> 5) & 1], REG_BIT(pin & 0x1f));
 
 	return gpio_no_error;
 }
@@ -198,7 +205,7 @@ inline gpio_err_t gpio_get_port(gpio_port_t port, uint32_t *port_data){
 		return gpio_invalid_parameter;
 	}
 
-	*port_data = gpio_regs->DATA[port];
+	*port_data = REG_READ(gpio_regs->DATA[port]);
 
 	return gpio_no_error;
 }
@@ -218,7 +225,7 @@ inline gpio_err_t gpio_get_pin(gpio_pin_t pin, uint32_t *pin_data){
 		return gpio_invalid_parameter;
 	}
 
-	*pin_data = (gpio_regs->DATA[pin >> 5]) & (1 << (pin & 0x1f));
+	*pin_data = REG_READ(gpio_regs->DATA[pin >> 5]) & REG_BIT(pin & 0x1f);
 
 	return gpio_no_error;
 }
@@ -235,19 +242,27 @@ inline gpio_err_t gpio_get_pin(gpio_pin_t pin, uint32_t *pin_data){
  *			gpio_invalid_parameter en otro caso
  */
 inline gpio_err_t gpio_set_port_func(gpio_port_t port, gpio_func_t func, uint32_t mask){
-	uint32_t i, pin, reg, offset;
+	uint32_t i, half, clear, set;
 
 	if (port >= gpio_port_max || func >= gpio_func_max){
 		return gpio_invalid_parameter;
 	}
 
-	for (i = 0; i < 32; i++){
-		if (mask & (1 << i)){	/* Si hay que modificar el modo de funcionamiento de este pin */
-			pin = i + (port << 5);
-			reg = pin >> 4;
-			offset = (pin & 0xf) << 1;
-			gpio_regs->FUNC_SEL[reg] &= (~(3 << offset));	/* Hacemos ceros en los bits de máscara */
-			gpio_regs->FUNC_SEL[reg] |= (func << offset);	/* Escribimos el modo de funcionamiento */
+	/* Cada puerto ocupa dos registros FUNC_SEL de 16 pines: acumulamos los */
+	/* campos de cada uno y lo escribimos con una sola lectura-escritura */
+	for (half = 0; half < 2; half++){
+		clear = 0;
+		set = 0;
+
+		for (i = 0; i < 16; i++){
+			if (mask & (1 << (i + (half << 4)))){	/* Si hay que modificar el modo de funcionamiento de este pin */
+				clear |= GPIO_FUNC_SEL_MASK(i);
+				set |= (uint32_t) func << GPIO_FUNC_SEL_SHIFT(i);
+			}
+		}
+
+		if (clear){
+			REG_MODIFY(gpio_regs->FUNC_SEL[(port << 1) + half], clear, set);
 		}
 	}
 
@@ -265,16 +280,12 @@ inline gpio_err_t gpio_set_port_func(gpio_port_t port, gpio_func_t func, uint32_
  *			gpio_invalid_parameter en otro caso
  */
 inline gpio_err_t gpio_set_pin_func(gpio_pin_t pin, gpio_func_t func){
-	uint32_t reg, offset;
-
 	if (pin >= gpio_pin_max || func >= gpio_func_max){
 		return gpio_invalid_parameter;
 	}
 
-	reg = pin >> 4;
-	offset = (pin & 0xf) << 1;
-	gpio_regs->FUNC_SEL[reg] &= (~(3 << offset));		/* Hacemos ceros en los bits de máscara */
-	gpio_regs->FUNC_SEL[reg] |= (func << offset);		/* Escribimos el modo de funcionamiento */
+	/* Borramos el campo del pin y escribimos el modo en una sola escritura */
+	REG_MODIFY(gpio_regs->FUNC_SEL[pin >> 4], GPIO_FUNC_SEL_MASK(pin), (uint32_t) func << GPIO_FUNC_SEL_SHIFT(pin));
 
 	return gpio_no_error;
 }
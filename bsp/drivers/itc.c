@@ -3,7 +3,13 @@
  * Driver para el controlador de interrupciones del MC1322x
  */
 
+#ifdef ITC_STATS
+#include <stdio.h>
+#include <string.h>
+#endif
+
 #include "system.h"
+#include "reg.h"
 
 /*****************************************************************************/
 
@@ -26,18 +32,58 @@ typedef struct{
 	volatile uint32_t const fipend;
 } itc_regs_t;
 
+/**
+ * Bits de arbitraje de intcntl (IRQ y FIQ)
+ */
+#define ITC_INTCNTL_NIAD		REG_BIT(20)
+#define ITC_INTCNTL_FIAD		REG_BIT(19)
+
 static volatile itc_regs_t* const itc_regs = ITC_BASE;
 
 /**
  * Tabla de manejadores de interrupción.
+ * No es estática porque los despachadores en ensamblador la indexan
+ * directamente con el valor de nivector/fivector
  */
-static itc_handler_t itc_handlers[itc_src_max];
+itc_handler_t itc_handlers[itc_src_max];
 
 /**
  *	Variable global para guardar intenable
  */
 static volatile uint32_t intenable_status;
 
+/**
+ * Nivel de anidamiento de itc_disable_ints
+ */
+static volatile uint32_t intenable_nesting;
+
+/**
+ * Prototipo con el que los despachadores invocan a los manejadores
+ */
+typedef void (* itc_isr_t) (itc_src_t src, excep_irq_frame_t *frame);
+
+#ifdef ITC_STATS
+
+/**
+ * Manejadores registrados por los drivers. En itc_handlers se instala
+ * itc_stats_service, que mide la duración de cada llamada
+ */
+static itc_handler_t itc_stats_handlers[itc_src_max];
+
+/**
+ * Estadísticas de cada fuente
+ */
+static volatile itc_stats_t itc_stats[itc_src_max];
+
+/**
+ * Instante de activación anunciado para cada fuente, o cero si no se conoce
+ */
+static volatile uint64_t itc_stats_asserted[itc_src_max];
+
+static void itc_stats_service (itc_src_t src, excep_irq_frame_t *frame);
+
+#endif /* ITC_STATS */
+
 /*****************************************************************************/
 
 /**
@@ -54,16 +100,16 @@ inline void itc_init(){
 	}
 
 	// No provocar ninguna interrupción simulada al arrancar
-	itc_regs->intfrc = (uint32_t) 0;
+	REG_WRITE(itc_regs->intfrc, 0);
 
 	// Deshabilitar todas las fuentes de interrupción al activar el controlador
-	itc_regs->intenable = (uint32_t) 0;
-	
-	// Activar arbitraje de interrupciones IRQ
-	itc_regs->intcntl = ~(uint32_t)(1 << 19);
-	
-	// Activar arbitraje de interrupciones FIQ
-	itc_regs->intcntl = ~(uint32_t)(1 << 20);
+	REG_WRITE(itc_regs->intenable, 0);
+
+	// Todas las fuentes son normales hasta que se indique lo contrario
+	REG_WRITE(itc_regs->inttype, 0);
+
+	// Activar arbitraje de interrupciones IRQ (NIAD) y FIQ (FIAD)
+	REG_CLEAR_BITS(itc_regs->intcntl, ITC_INTCNTL_NIAD | ITC_INTCNTL_FIAD);
 }
 
 /*****************************************************************************/
@@ -71,11 +117,15 @@ inline void itc_init(){
 /**
  * Deshabilita el envío de peticiones de interrupción a la CPU
  * Permite implementar regiones críticas en modo USER
+ * Las llamadas se pueden anidar: sólo la más externa guarda intenable
  */
 inline void itc_disable_ints(){
-	intenable_status = itc_regs->intenable;
+	uint32_t token = itc_critical_enter();
 
-	itc_regs->intenable = (uint32_t) 0;
+	/* Ya no puede llegar ninguna interrupción que modifique el contador */
+	if(intenable_nesting++ == 0){
+		intenable_status = token;
+	}
 }
 
 /*****************************************************************************/
@@ -83,9 +133,56 @@ inline void itc_disable_ints(){
 /**
  * Vuelve a habilitar el envío de peticiones de interrupción a la CPU
  * Permite implementar regiones críticas en modo USER
+ * Sólo la llamada que cierra la región más externa restaura intenable
  */
 inline void itc_restore_ints(){
-	itc_regs->intenable = intenable_status;
+	if(--intenable_nesting == 0){
+		itc_critical_exit(intenable_status);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Entra en una región crítica enmascarando en el ITC todas las fuentes
+ * Permite implementar regiones críticas en modo USER
+ * @return	Token con las fuentes que estaban habilitadas, para itc_critical_exit
+ */
+inline uint32_t itc_critical_enter(){
+	uint32_t token = REG_READ(itc_regs->intenable);
+
+	REG_WRITE(itc_regs->intenable, 0);
+
+	return token;
+}
+
+/*****************************************************************************/
+
+/**
+ * Entra en una región crítica enmascarando sólo algunas fuentes
+ * Las fuentes que no están en la máscara siguen pudiendo interrumpir
+ * @param mask	Máscara de fuentes a enmascarar (bit i para la fuente i)
+ * @return		Token con las fuentes de la máscara que estaban habilitadas,
+ * 				para itc_critical_exit
+ */
+inline uint32_t itc_critical_enter_mask(uint32_t mask){
+	uint32_t enabled = REG_READ(itc_regs->intenable);
+
+	REG_WRITE(itc_regs->intenable, enabled & ~mask);
+
+	return enabled & mask;
+}
+
+/*****************************************************************************/
+
+/**
+ * Sale de una región crítica
+ * Sólo vuelve a habilitar las fuentes que deshabilitó la entrada
+ * correspondiente, por lo que las regiones se pueden anidar
+ * @param token	Valor retornado por itc_critical_enter o itc_critical_enter_mask
+ */
+inline void itc_critical_exit(uint32_t token){
+	REG_SET_BITS(itc_regs->intenable, token);
 }
 
 /*****************************************************************************/
@@ -96,7 +193,12 @@ inline void itc_restore_ints(){
  * @param handler	Manejador
  */
 inline void itc_set_handler(itc_src_t src, itc_handler_t handler){
+#ifdef ITC_STATS
+	itc_stats_handlers[src] = handler;
+	itc_handlers[src] = handler ? (itc_handler_t) itc_stats_service : NULL;
+#else
 	itc_handlers[src] = handler;
+#endif
 }
 
 /*****************************************************************************/
@@ -108,18 +210,32 @@ inline void itc_set_handler(itc_src_t src, itc_handler_t handler){
  */
 inline void itc_set_priority(itc_src_t src, itc_priority_t priority){
 	if(priority){
-		// Las interrupciones FIQ son las de alta prioridad, por lo que
-		// será el único bit activo, así que se usa = en lugar de hacer
-		// OR o AND
-		itc_regs->inttype = (uint32_t)(1 << src);
+		// Puede haber varias fuentes rápidas a la vez, así que sólo
+		// activamos el bit de esta fuente
+		REG_SET_BITS(itc_regs->inttype, REG_BIT(src));
 	}
 	else{
-		itc_regs->inttype &= ~(uint32_t)(1 << src);
+		REG_CLEAR_BITS(itc_regs->inttype, REG_BIT(src));
 	}
 }
 
 /*****************************************************************************/
 
+/**
+ * Registra el manejador de una fuente de interrupción rápida (FIQ).
+ * Asigna el manejador, marca la fuente como rápida y la habilita. El
+ * manejador se ejecuta desde excep_fiq_handler en modo FIQ
+ * @param src		Identificador de la fuente
+ * @param handler	Manejador
+ */
+void itc_set_fast_handler(itc_src_t src, itc_handler_t handler){
+	itc_set_handler(src, handler);
+	itc_set_priority(src, itc_priority_fast);
+	itc_enable_interrupt(src);
+}
+
+/*****************************************************************************/
+
 /**
  * Habilita las interrupciones de una determinda fuente
  * @param src		Identificador de la fuente
@@ -127,7 +243,7 @@ inline void itc_set_priority(itc_src_t src, itc_priority_t priority){
 inline void itc_enable_interrupt(itc_src_t src){
 	// Es el bit 000...001 desplazado a la izquierda 'src' veces,
 	// para habilitar las interrupciones correspondientes
-	itc_regs->intenable |= (uint32_t)(1 << src);
+	REG_SET_BITS(itc_regs->intenable, REG_BIT(src));
 }
 
 /*****************************************************************************/
@@ -139,7 +255,7 @@ inline void itc_enable_interrupt(itc_src_t src){
 inline void itc_disable_interrupt(itc_src_t src){
 	// Hace el mismo desplazamiento que en la función anterior y AND para
 	// poner a 0 solo el bit correspondiente
-	itc_regs->intenable &= ~(uint32_t)(1 << src);
+	REG_CLEAR_BITS(itc_regs->intenable, REG_BIT(src));
 }
 
 /*****************************************************************************/
@@ -149,7 +265,10 @@ inline void itc_disable_interrupt(itc_src_t src){
  * @param src		Identificador de la fuente
  */
 inline void itc_force_interrupt(itc_src_t src){
-	itc_regs->intfrc |= (uint32_t)(1 << src);	// Ponemos el bit indicado a 1
+#ifdef ITC_STATS
+	itc_stats_assert(src, tmr_get_ticks());
+#endif
+	REG_SET_BITS(itc_regs->intfrc, REG_BIT(src));	// Ponemos el bit indicado a 1
 }
 
 /*****************************************************************************/
@@ -159,7 +278,7 @@ inline void itc_force_interrupt(itc_src_t src){
  * @param src		Identificador de la fuente
  */
 inline void itc_unforce_interrupt(itc_src_t src){
-	itc_regs->intfrc &= ~(uint32_t)(1 << src);
+	REG_CLEAR_BITS(itc_regs->intfrc, REG_BIT(src));
 }
 
 /*****************************************************************************/
@@ -171,7 +290,9 @@ inline void itc_unforce_interrupt(itc_src_t src){
  * completado el servicio de la IRQ para evitar inversiones de prioridad
  */
 void itc_service_normal_interrupt(){
-	itc_handlers[itc_regs->nivector]();		/* Servimos la IRQ */
+	itc_src_t src = REG_READ(itc_regs->nivector);
+
+	((itc_isr_t) itc_handlers[src])(src, NULL);	/* Servimos la IRQ */
 }
 
 /*****************************************************************************/
@@ -181,7 +302,150 @@ void itc_service_normal_interrupt(){
  */
 void itc_service_fast_interrupt(){
 	// Obtener el indice del manejador de la fiq y llamar a la rutina
-    itc_handlers[itc_regs->fivector]();
+	itc_src_t src = REG_READ(itc_regs->fivector);
+
+	((itc_isr_t) itc_handlers[src])(src, NULL);
 }
 
 /*****************************************************************************/
+
+#ifdef ITC_STATS
+
+/**
+ * Sirve una interrupción midiendo su latencia y su duración con el reloj
+ * monotónico de 64 bits, que no se desborda aunque el manejador dure más
+ * de una vuelta del contador de 16 bits
+ * Se instala en itc_handlers en lugar del manejador del driver, así que la
+ * usan tanto los despachadores en ensamblador como itc_service_*_interrupt
+ * @param src		Fuente atendida
+ * @param frame		Contexto interrumpido, se pasa tal cual al manejador
+ */
+static void itc_stats_service(itc_src_t src, excep_irq_frame_t *frame){
+	volatile itc_stats_t *stats = &itc_stats[src];
+	uint64_t start, asserted;
+	uint32_t latency, duration, bin;
+
+	start = tmr_get_ticks();
+	asserted = itc_stats_asserted[src];
+
+	/* Un instante futuro corresponde a una activación que aún no ha */
+	/* llegado: esta interrupción es otra de la misma fuente */
+	if(asserted && asserted <= start){
+		itc_stats_asserted[src] = 0;
+		latency = (uint32_t) (start - asserted);
+
+		if(stats->latency_count == 0 || latency < stats->latency_min){
+			stats->latency_min = latency;
+		}
+
+		if(latency > stats->latency_max){
+			stats->latency_max = latency;
+		}
+
+		stats->latency_count++;
+		stats->latency_total += latency;
+	}
+
+	((itc_isr_t) itc_stats_handlers[src])(src, frame);
+
+	duration = (uint32_t) (tmr_get_ticks() - start);
+
+	/* Intervalo del histograma: posición del bit más significativo */
+	bin = duration ? 31 - __builtin_clz(duration) : 0;
+
+	if(stats->count == 0 || duration < stats->min){
+		stats->min = duration;
+	}
+
+	if(duration > stats->max){
+		stats->max = duration;
+	}
+
+	stats->count++;
+	stats->total += duration;
+	stats->histogram[bin]++;
+}
+
+/*****************************************************************************/
+
+/**
+ * Anuncia el instante en el que una fuente se activará o se ha activado,
+ * para medir la latencia de la siguiente interrupción que lo alcance
+ * @param src		Identificador de la fuente
+ * @param ticks		Instante de activación, en ticks de tmr_get_ticks
+ */
+void itc_stats_assert(itc_src_t src, uint64_t ticks){
+	itc_stats_asserted[src] = ticks;
+}
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas acumuladas para una fuente de interrupción
+ * @param src		Identificador de la fuente
+ * @param stats		Estructura donde se copian las estadísticas
+ */
+void itc_stats_get(itc_src_t src, itc_stats_t *stats){
+	/* Evitamos que una interrupción modifique los datos durante la copia */
+	uint32_t token = itc_critical_enter();
+
+	memcpy(stats, (const void *) &itc_stats[src], sizeof(itc_stats_t));
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Pone a cero las estadísticas de todas las fuentes
+ */
+void itc_stats_reset(){
+	uint32_t token = itc_critical_enter();
+
+	memset((void *) itc_stats, 0, sizeof(itc_stats));
+	memset((void *) itc_stats_asserted, 0, sizeof(itc_stats_asserted));
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime por la salida estándar las estadísticas de las fuentes que han
+ * generado alguna interrupción
+ */
+void itc_stats_print(){
+	itc_stats_t stats;
+	uint32_t src, i;
+
+	iprintf("src count min max mean (ticks @ %u Hz)\r\n", tmr_get_freq());
+
+	for(src = 0; src < itc_src_max; src++){
+		itc_stats_get(src, &stats);
+
+		if(stats.count == 0){
+			continue;
+		}
+
+		iprintf("%2lu %8lu %6lu %6lu %6lu\r\n", src, stats.count, stats.min,
+				stats.max, (uint32_t) (stats.total / stats.count));
+
+		/* Latencia desde la activación, si se ha podido medir */
+		if(stats.latency_count){
+			iprintf("   latency %8lu %6lu %6lu %6lu\r\n", stats.latency_count,
+					stats.latency_min, stats.latency_max,
+					(uint32_t) (stats.latency_total / stats.latency_count));
+		}
+
+		/* Histograma: límite superior (2^(i+1)) y número de muestras */
+		for(i = 0; i < ITC_STATS_BINS; i++){
+			if(stats.histogram[i]){
+				iprintf("   < 2^%-2lu %8lu\r\n", i + 1, stats.histogram[i]);
+			}
+		}
+	}
+}
+
+#endif /* ITC_STATS */
+
+/*****************************************************************************/
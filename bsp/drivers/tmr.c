@@ -0,0 +1,489 @@
+/*
+ * Sistemas operativos empotrados
+ * Driver para los temporizadores del MC1322x
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Acceso estructurado a los registros de control de un temporizador del
+ * MC1322x. Los registros son de 16 bits y cada temporizador ocupa 0x20 bytes
+ */
+typedef struct{
+	volatile uint16_t COMP1;		// Compare Register 1
+	volatile uint16_t COMP2;		// Compare Register 2
+	volatile uint16_t CAPT;			// Capture Register
+	volatile uint16_t LOAD;			// Load Register
+	volatile uint16_t HOLD;			// Hold Register
+	volatile uint16_t CNTR;			// Counter Register
+	volatile uint16_t CTRL;			// Control Register
+	volatile uint16_t SCTRL;		// Status and Control Register
+	volatile uint16_t CMPLD1;		// Comparator Load Register 1
+	volatile uint16_t CMPLD2;		// Comparator Load Register 2
+	volatile uint16_t CSCTRL;		// Comparator Status and Control Register
+	const uint16_t RESERVED[4];
+	volatile uint16_t ENBL;			// Channel Enable Register (sólo en TMR0)
+} tmr_regs_t;
+
+static volatile tmr_regs_t* const tmr_regs = TMR_BASE;
+
+/*****************************************************************************/
+
+/**
+ * Campos del registro CTRL
+ */
+#define TMR_CTRL_CM_RISING		(1 << 13)	/* Cuenta flancos de subida de la fuente primaria */
+#define TMR_CTRL_PCS_BUS_DIV1	(8 << 9)	/* Fuente primaria: reloj del bus / 1 */
+#define TMR_CTRL_PCS_BUS_DIV(n)	((8 + (n)) << 9)	/* Fuente primaria: reloj del bus / 2^n, n < 8 */
+#define TMR_CTRL_LENGTH			(1 << 5)	/* Recarga LOAD al coincidir con COMP1 */
+
+/**
+ * Campos del registro SCTRL
+ */
+#define TMR_SCTRL_TCF			(1 << 15)	/* Coincidencia con COMP1 */
+#define TMR_SCTRL_TCFIE			(1 << 14)	/* Interrupción de coincidencia */
+#define TMR_SCTRL_TOF			(1 << 13)	/* Desbordamiento */
+#define TMR_SCTRL_TOFIE			(1 << 12)	/* Interrupción de desbordamiento */
+
+/*****************************************************************************/
+
+/**
+ * Número de desbordamientos del contador libre (los 48 bits altos del reloj)
+ */
+static volatile uint64_t tmr_overflows;
+
+/**
+ * Alarma programada. Está activa mientras tmr_alarm_callback no sea NULL
+ */
+static uint64_t tmr_alarm;
+static volatile tmr_callback_t tmr_alarm_callback;
+
+/**
+ * Manejadores y frecuencias de los temporizadores periódicos
+ */
+static volatile tmr_handler_t tmr_handlers[tmr_max];
+static uint32_t tmr_periodic_hz[tmr_max];
+
+/**
+ * Origen de la conversión de ticks a tiempo: los ticks cambian de duración
+ * con la frecuencia del bus, así que cada cambio fija un nuevo origen
+ * tmr_epoch_seq cambia durante la actualización, para que los lectores
+ * puedan detectarla y repetir
+ */
+static volatile uint64_t tmr_epoch_ticks;
+static volatile uint64_t tmr_epoch_ns;
+static volatile uint32_t tmr_epoch_seq;
+
+/*****************************************************************************/
+
+/**
+ * Programa el comparador del contador libre para la alarma, si vence antes
+ * de que el contador dé una vuelta completa. Las alarmas más lejanas se
+ * reprograman desde la interrupción de desbordamiento
+ * Se debe llamar con la interrupción de los temporizadores enmascarada
+ * @return	1 si la alarma ya ha vencido
+ */
+static uint32_t tmr_alarm_program(void){
+	volatile tmr_regs_t *clock = &tmr_regs[TMR_CLOCK_ID];
+	uint64_t now = tmr_get_ticks();
+
+	if(now < tmr_alarm && tmr_alarm - now <= 0xffff){
+		clock->COMP1 = (uint16_t) tmr_alarm;
+		clock->SCTRL |= TMR_SCTRL_TCFIE;
+
+#ifdef ITC_STATS
+		/* La coincidencia activa la fuente justo en el instante de la alarma */
+		itc_stats_assert(itc_src_tmr, tmr_alarm);
+#endif
+
+		/* Si el contador ha alcanzado el valor mientras lo escribíamos, */
+		/* la coincidencia no se producirá hasta la siguiente vuelta */
+		now = tmr_get_ticks();
+	}
+
+	return now >= tmr_alarm;
+}
+
+/*****************************************************************************/
+
+/**
+ * Manejador de interrupciones de los temporizadores
+ * Los cuatro temporizadores comparten la fuente itc_src_tmr
+ * @param src	Fuente de la interrupción
+ * @param frame	Contexto interrumpido, se pasa a los temporizadores periódicos
+ */
+static void tmr_isr(itc_src_t src, excep_irq_frame_t *frame){
+	volatile tmr_regs_t *clock = &tmr_regs[TMR_CLOCK_ID];
+	uint32_t id;
+
+	for(id = 0; id < tmr_max; id++){
+		if(tmr_handlers[id] && (tmr_regs[id].SCTRL & TMR_SCTRL_TCF)){
+			tmr_regs[id].SCTRL &= ~TMR_SCTRL_TCF;
+			tmr_handlers[id](frame);
+		}
+	}
+
+	if(clock->SCTRL & TMR_SCTRL_TOF){
+		/* Primero se actualiza la cuenta y después se reconoce la */
+		/* interrupción, como espera tmr_get_ticks */
+		tmr_overflows++;
+		clock->SCTRL &= ~TMR_SCTRL_TOF;
+	}
+
+	if(clock->SCTRL & TMR_SCTRL_TCF){
+		clock->SCTRL &= ~TMR_SCTRL_TCF;
+	}
+
+	/* tmr_set_alarm fuerza la interrupción si la alarma ya ha vencido */
+	itc_unforce_interrupt(itc_src_tmr);
+
+	if(tmr_alarm_callback && tmr_alarm_program()){
+		tmr_callback_t callback = tmr_alarm_callback;
+
+		/* Se desactiva antes de llamar, para que pueda reprogramarse */
+		tmr_alarm_callback = NULL;
+		clock->SCTRL &= ~TMR_SCTRL_TCFIE;
+		callback();
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Programa y arranca un temporizador periódico
+ * @param id		Temporizador
+ * @param hz		Frecuencia de las interrupciones
+ * @param freq		Frecuencia del bus
+ * @return			Cero en caso de éxito o -1 si la frecuencia no es alcanzable
+ */
+static int32_t tmr_program_periodic(tmr_id_t id, uint32_t hz, uint32_t freq){
+	volatile tmr_regs_t *timer = &tmr_regs[id];
+	uint32_t n, period = 0;
+
+	for(n = 0; n < 8; n++){
+		period = (freq >> n) / hz;
+
+		if(period <= 0x10000){
+			break;
+		}
+	}
+
+	if(period == 0 || period > 0x10000){
+		return -1;
+	}
+
+	tmr_regs[tmr_0].ENBL &= ~(1 << id);
+
+	timer->CTRL = 0;
+	timer->SCTRL = 0;
+	timer->CSCTRL = 0;
+	timer->LOAD = 0;
+	timer->CNTR = 0;
+	timer->COMP1 = period - 1;
+
+	timer->CTRL = TMR_CTRL_CM_RISING | TMR_CTRL_PCS_BUS_DIV(n) | TMR_CTRL_LENGTH;
+	timer->SCTRL = TMR_SCTRL_TCFIE;
+
+	tmr_regs[tmr_0].ENBL |= 1 << id;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Adapta los temporizadores a un cambio de frecuencia del bus
+ * Antes del cambio rechaza las frecuencias que no admiten algún temporizador
+ * periódico. Justo antes de escribir el divisor fija un nuevo origen para la
+ * conversión de ticks a tiempo. Después reprograma los temporizadores
+ * periódicos. Las alarmas
+ * están en ticks, así que las reprograma quien las usa
+ * @param event		Fase del cambio
+ * @param old_freq	Frecuencia anterior
+ * @param new_freq	Frecuencia nueva
+ * @return			Distinto de cero para rechazar el cambio
+ */
+static int32_t tmr_clock_notifier(crm_clock_event_t event, uint32_t old_freq, uint32_t new_freq){
+	uint64_t ns;
+	uint32_t id;
+
+	if(event == crm_clock_pre_change){
+		for(id = 0; id < tmr_max; id++){
+			if(tmr_handlers[id] && new_freq < tmr_periodic_hz[id]){
+				return -1;
+			}
+		}
+	}
+	else if(event == crm_clock_switch){
+		/* Se mide con la frecuencia anterior, que sigue vigente hasta la */
+		/* escritura del divisor, que se hace a continuación */
+		ns = tmr_get_ns();
+		tmr_epoch_ticks = tmr_get_ticks();
+		tmr_epoch_ns = ns;
+		tmr_epoch_seq++;
+	}
+	else if(event == crm_clock_post_change){
+		for(id = 0; id < tmr_max; id++){
+			if(tmr_handlers[id]){
+				tmr_program_periodic(id, tmr_periodic_hz[id], new_freq);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa los temporizadores.
+ * El temporizador TMR_CLOCK_ID queda contando libremente a la frecuencia del
+ * bus de periféricos. Su interrupción de desbordamiento extiende la cuenta
+ * a 64 bits
+ */
+void tmr_init(){
+	volatile tmr_regs_t *clock = &tmr_regs[TMR_CLOCK_ID];
+
+	/* Detenemos el temporizador mientras lo configuramos */
+	tmr_regs[tmr_0].ENBL &= ~(1 << TMR_CLOCK_ID);
+
+	clock->CTRL = 0;
+	clock->SCTRL = 0;
+	clock->CSCTRL = 0;
+	clock->LOAD = 0;
+	clock->CNTR = 0;
+
+	tmr_overflows = 0;
+	tmr_alarm_callback = NULL;
+
+	tmr_epoch_ticks = 0;
+	tmr_epoch_ns = 0;
+	crm_register_notifier(tmr_clock_notifier);
+
+	/* Cuenta ascendente sin recarga: desborda de 0xffff a 0 */
+	clock->CTRL = TMR_CTRL_CM_RISING | TMR_CTRL_PCS_BUS_DIV1;
+	clock->SCTRL = TMR_SCTRL_TOFIE;
+
+	itc_set_priority(itc_src_tmr, itc_priority_normal);
+	itc_set_handler(itc_src_tmr, (itc_handler_t) tmr_isr);
+	itc_enable_interrupt(itc_src_tmr);
+
+	tmr_regs[tmr_0].ENBL |= 1 << TMR_CLOCK_ID;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el valor actual del contador libre
+ * El contador es de 16 bits, por lo que sólo sirve para medir intervalos
+ * cortos mediante la diferencia módulo 2^16 de dos lecturas
+ * @return	El valor del contador
+ */
+inline uint32_t tmr_get_count(){
+	return tmr_regs[TMR_CLOCK_ID].CNTR;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de ticks transcurridos desde el arranque
+ * Se puede llamar desde cualquier contexto, incluso con las interrupciones
+ * deshabilitadas durante menos de un desbordamiento (2^16 ticks)
+ * @return	Ticks del reloj monotónico de 64 bits
+ */
+uint64_t tmr_get_ticks(){
+	volatile tmr_regs_t *clock = &tmr_regs[TMR_CLOCK_ID];
+	uint64_t high;
+	uint32_t count, pending;
+
+	/* Si tmr_isr se ejecuta durante la lectura, repetimos */
+	do{
+		high = tmr_overflows;
+		count = clock->CNTR;
+		pending = clock->SCTRL & TMR_SCTRL_TOF;
+
+		/* Desbordamiento aún no atendido: la cuenta válida es posterior a él */
+		if(pending){
+			count = clock->CNTR;
+		}
+	}while(high != tmr_overflows);
+
+	if(pending){
+		high++;
+	}
+
+	return (high << 16) | count;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna la frecuencia actual de los ticks, la del bus de periféricos
+ * @return	Ticks por segundo
+ */
+inline uint32_t tmr_get_freq(){
+	return crm_get_freq();
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de nanosegundos transcurridos desde el arranque
+ * Es continuo a través de los cambios de frecuencia del bus
+ * @return	Nanosegundos del reloj monotónico
+ */
+uint64_t tmr_get_ns(){
+	uint64_t ticks, epoch_ticks, epoch_ns;
+	uint32_t seq, freq;
+
+	do{
+		seq = tmr_epoch_seq;
+		epoch_ticks = tmr_epoch_ticks;
+		epoch_ns = tmr_epoch_ns;
+		freq = tmr_get_freq();
+		ticks = tmr_get_ticks();
+	}while(seq != tmr_epoch_seq);
+
+	ticks -= epoch_ticks;
+
+	/* Separamos segundos y resto para no desbordar la multiplicación */
+	return epoch_ns + (ticks / freq) * 1000000000 + (ticks % freq) * 1000000000 / freq;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de microsegundos transcurridos desde el arranque
+ * @return	Microsegundos del reloj monotónico
+ */
+uint64_t tmr_get_us(){
+	return tmr_get_ns() / 1000;
+}
+
+/*****************************************************************************/
+
+/**
+ * Convierte microsegundos a ticks
+ * @param us	Microsegundos
+ * @return		Ticks equivalentes
+ */
+uint64_t tmr_us_to_ticks(uint64_t us){
+	uint32_t freq = tmr_get_freq();
+
+	return (us / 1000000) * freq + (us % 1000000) * freq / 1000000;
+}
+
+/*****************************************************************************/
+
+/**
+ * Espera activa de un número de microsegundos
+ * @param us	Microsegundos
+ */
+void tmr_delay_us(uint32_t us){
+	uint64_t end = tmr_get_ticks() + tmr_us_to_ticks(us);
+
+	while(tmr_get_ticks() < end);
+}
+
+/*****************************************************************************/
+
+/**
+ * Programa una alarma. Sólo hay una alarma, así que sustituye a la anterior
+ * La función se llama desde el manejador de interrupción de los
+ * temporizadores, aunque la alarma ya haya vencido al programarla
+ * @param ticks		Instante de vencimiento, en ticks del reloj monotónico
+ * @param callback	Función a llamar al vencer
+ */
+void tmr_set_alarm(uint64_t ticks, tmr_callback_t callback){
+	uint32_t token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	tmr_alarm = ticks;
+	tmr_alarm_callback = callback;
+
+	if(tmr_alarm_program()){
+		itc_force_interrupt(itc_src_tmr);
+	}
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Cancela la alarma programada
+ */
+void tmr_cancel_alarm(){
+	uint32_t token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	tmr_alarm_callback = NULL;
+	tmr_regs[TMR_CLOCK_ID].SCTRL &= ~TMR_SCTRL_TCFIE;
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador periódico
+ * Se busca el menor divisor del reloj del bus con el que el periodo cabe en
+ * el comparador de 16 bits
+ * @param id		Temporizador. No puede ser TMR_CLOCK_ID
+ * @param hz		Frecuencia de las interrupciones
+ * @param handler	Manejador, que se llama desde la interrupción
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t tmr_start_periodic(tmr_id_t id, uint32_t hz, tmr_handler_t handler){
+	uint32_t token;
+
+	if(id >= tmr_max || id == TMR_CLOCK_ID || handler == NULL || hz == 0){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	tmr_stop_periodic(id);
+
+	token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	if(tmr_program_periodic(id, hz, tmr_get_freq())){
+		itc_critical_exit(token);
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	tmr_periodic_hz[id] = hz;
+	tmr_handlers[id] = handler;
+
+	itc_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Detiene un temporizador periódico
+ * @param id		Temporizador
+ */
+void tmr_stop_periodic(tmr_id_t id){
+	uint32_t token;
+
+	if(id >= tmr_max || id == TMR_CLOCK_ID){
+		return;
+	}
+
+	token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	tmr_regs[tmr_0].ENBL &= ~(1 << id);
+	tmr_regs[id].SCTRL = 0;
+	tmr_handlers[id] = NULL;
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
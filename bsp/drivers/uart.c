@@ -7,88 +7,83 @@
 #include <errno.h>
 #include "system.h"
 #include "circular_buffer.h"
+#include "reg.h"
 
 /*****************************************************************************/
 
 /**
  * Acceso estructurado a los registros de control de las uart del MC1322x
+ * Los campos se acceden con las macros de reg.h
  */
-
 typedef struct{
-	// UART Control Register
-	union{
-		struct{
-			uint32_t TxE		: 1;
-			uint32_t RxE		: 1;
-			uint32_t PEN		: 1;
-			uint32_t EP			: 1;
-			uint32_t ST2		: 1;
-			uint32_t SB			: 1;
-			uint32_t conTx		: 1;
-			uint32_t Tx_oen_b	: 1;
-			uint32_t			: 2;
-			uint32_t xTIM		: 1;
-			uint32_t FCp		: 1;
-			uint32_t FCe		: 1;
-			uint32_t mTxR		: 1;
-			uint32_t mRxR		: 1;
-			uint32_t TST		: 1;
-		};
-
-		uint32_t CON;
-	};
-
-	// UART Status Register
-	union{
-		struct{
-			uint32_t SE			: 1;
-			uint32_t PE			: 1;
-			uint32_t FE			: 1;
-			uint32_t TOE		: 1;
-			uint32_t ROE		: 1;
-			uint32_t RUE		: 1;
-			uint32_t RxRdy		: 1;
-			uint32_t TxRdy		: 1;
-		};
-
-		uint32_t STAT;
-	};
-
-	// UART Data Register
-	union{
-		uint8_t Rx_data;
-		uint8_t Tx_data;
-		uint32_t DATA;
-	};
-
-	// UART RxBuffer Control Register
-	union{
-		uint32_t RxLevel			: 5;
-		uint32_t Rx_fifo_addr_diff 	: 6;
-		uint32_t RxCON;
-	};
-
-	// UART TxBuffer Control Register
-	union{
-		uint32_t TxLevel			: 5;
-		uint32_t Tx_fifo_addr_diff	: 6;
-		uint32_t TxCON;
-	};
-
-	// UART CTS Level Control Register
-	uint32_t CTS;
-
-	// UART Baud Rate Divider Register
-	union{
-		struct{
-			uint32_t BRMOD	: 16;
-			uint32_t BRINC	: 16;
-		};
-
-		uint32_t BR;
-	};
+	uint32_t CON;			/* UART Control Register */
+	uint32_t STAT;			/* UART Status Register */
+	uint32_t DATA;			/* UART Data Register */
+	uint32_t RxCON;			/* UART RxBuffer Control Register */
+	uint32_t TxCON;			/* UART TxBuffer Control Register */
+	uint32_t CTS;			/* UART CTS Level Control Register */
+	uint32_t BR;			/* UART Baud Rate Divider Register */
 } uart_regs_t;
 
+/**
+ * Bits de CON
+ */
+#define UART_CON_TXE		REG_BIT(0)		/* Transmisor habilitado */
+#define UART_CON_RXE		REG_BIT(1)		/* Receptor habilitado */
+#define UART_CON_PEN		REG_BIT(2)		/* Paridad habilitada */
+#define UART_CON_EP			REG_BIT(3)		/* Paridad par */
+#define UART_CON_ST2		REG_BIT(4)		/* Dos bits de parada */
+#define UART_CON_SB			REG_BIT(5)		/* Envío de break */
+#define UART_CON_CONTX		REG_BIT(6)		/* Transmisión continua */
+#define UART_CON_TX_OEN_B	REG_BIT(7)		/* Salida TX deshabilitada */
+#define UART_CON_XTIM		REG_BIT(10)		/* Oversampling de 8x */
+#define UART_CON_FCP		REG_BIT(11)		/* Polaridad del control de flujo */
+#define UART_CON_FCE		REG_BIT(12)		/* Control de flujo habilitado */
+#define UART_CON_MTXR		REG_BIT(13)		/* Interrupción del transmisor enmascarada */
+#define UART_CON_MRXR		REG_BIT(14)		/* Interrupción del receptor enmascarada */
+#define UART_CON_TST		REG_BIT(15)		/* Modo de prueba */
+
+/**
+ * Bits de STAT. Leer STAT borra los bits de error
+ */
+#define UART_STAT_SE		REG_BIT(0)		/* Error de inicio */
+#define UART_STAT_PE		REG_BIT(1)		/* Error de paridad */
+#define UART_STAT_FE		REG_BIT(2)		/* Error de trama */
+#define UART_STAT_TOE		REG_BIT(3)		/* Desbordamiento de la cola de envío */
+#define UART_STAT_ROE		REG_BIT(4)		/* Desbordamiento de la cola de recepción */
+#define UART_STAT_RUE		REG_BIT(5)		/* Lectura de la cola de recepción vacía */
+#define UART_STAT_RXRDY		REG_BIT(6)		/* Cola de recepción por encima del nivel */
+#define UART_STAT_TXRDY		REG_BIT(7)		/* Cola de envío por debajo del nivel */
+
+/**
+ * Campos de RxCON y TxCON. El mismo registro tiene un campo al escribirlo,
+ * el nivel que dispara la interrupción, y otro al leerlo, los bytes en la
+ * cola de recepción o los huecos en la de envío
+ */
+#define UART_RXCON_LEVEL_SHIFT		0
+#define UART_RXCON_LEVEL_MASK		REG_MASK(0, 5)
+#define UART_RXCON_COUNT_SHIFT		0
+#define UART_RXCON_COUNT_MASK		REG_MASK(0, 6)
+
+#define UART_TXCON_LEVEL_SHIFT		0
+#define UART_TXCON_LEVEL_MASK		REG_MASK(0, 5)
+#define UART_TXCON_FREE_SHIFT		0
+#define UART_TXCON_FREE_MASK		REG_MASK(0, 6)
+
+/**
+ * Campos de BR
+ */
+#define UART_BR_MOD_SHIFT			0
+#define UART_BR_MOD_MASK			REG_MASK(0, 16)
+#define UART_BR_INC_SHIFT			16
+#define UART_BR_INC_MASK			REG_MASK(16, 16)
+
+/**
+ * Huecos de la cola de envío y bytes en la de recepción
+ */
+#define uart_tx_free(uart)		REG_GET(uart_regs[uart]->TxCON, UART_TXCON_FREE)
+#define uart_rx_count(uart)		REG_GET(uart_regs[uart]->RxCON, UART_RXCON_COUNT)
+
 /*****************************************************************************/
 
 /**
@@ -132,12 +127,26 @@ static const itc_handler_t uart_irq_handlers[uart_max] = {
  */
 #define __UART_BUFFER_SIZE__	256
 
+/**
+ * Bytes que uart_send copia al búfer de transmisión en cada sección
+ * crítica, para acotar el tiempo con las interrupciones enmascaradas
+ */
+#define UART_SEND_CHUNK			8
+
 static volatile uint8_t uart_rx_buffers[uart_max][__UART_BUFFER_SIZE__];
 static volatile uint8_t uart_tx_buffers[uart_max][__UART_BUFFER_SIZE__];
 
 static volatile circular_buffer_t uart_circular_rx_buffers[uart_max];
 static volatile circular_buffer_t uart_circular_tx_buffers[uart_max];
 
+/**
+ * Ordena los mensajes completos de las tareas, para que no se entremezclen.
+ * Con herencia de prioridad, una tarea poco prioritaria que escribe no
+ * retrasa a una más prioritaria más allá de su copia. El búfer en sí lo
+ * protege la sección crítica de uart_send, que también excluye a los
+ * manejadores y al trabajo diferido, que no pueden tomar el mutex
+ */
+static mutex_t uart_tx_mutex[uart_max] = { MUTEX_INITIALIZER, MUTEX_INITIALIZER };
 
 /*****************************************************************************/
 
@@ -153,6 +162,114 @@ static volatile uart_callbacks_t uart_callbacks[uart_max];
 
 /*****************************************************************************/
 
+/**
+ * Baudrate de cada uart, 0 si no está inicializada
+ */
+static uint32_t uart_baudrates[uart_max];
+static uint32_t uart_notifier_registered;
+
+/**
+ * Transmisión suspendida durante un cambio de frecuencia: uart_isr no pasa
+ * datos del búfer a la cola hardware, que se queda vacía para el cambio
+ */
+static volatile uint32_t uart_tx_suspended[uart_max];
+
+/*****************************************************************************/
+
+/**
+ * Programa el divisor de una uart para su baudrate con la frecuencia actual
+ * del bus. La uart debe estar deshabilitada
+ * @param uart	Identificador de la uart
+ */
+static void uart_program_baudrate(uart_id_t uart){
+	uint32_t mod = 9999;
+	uint32_t inc = uart_baudrates[uart] * mod / (crm_get_freq() >> 4);
+
+	/* Fijamos la frecuencia, asumimos un oversampling de 8x */
+	REG_WRITE(uart_regs[uart]->BR, REG_VAL(UART_BR_INC, inc) | REG_VAL(UART_BR_MOD, mod));
+}
+
+/*****************************************************************************/
+
+/**
+ * Reanuda la transmisión suspendida por un cambio de frecuencia. Si quedan
+ * datos en el búfer, uart_isr vuelve a pasarlos a la cola hardware
+ * @param uart	Identificador de la uart
+ */
+static void uart_tx_resume(uart_id_t uart){
+	uart_tx_suspended[uart] = 0;
+
+	if(!circular_buffer_is_empty(&uart_circular_tx_buffers[uart])){
+		REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_MTXR);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Adapta las uarts a un cambio de frecuencia del bus
+ * Antes del cambio se rechaza si algún baudrate no es alcanzable con la nueva
+ * frecuencia. Si no, se suspende la transmisión, para que uart_isr deje de
+ * llenar la cola hardware, y se espera a que ésta y el último carácter
+ * salgan, para que ninguno salga a medias con el divisor equivocado. Lo que
+ * haya en el búfer se queda ahí, así que la espera está acotada aunque los
+ * productores sigan escribiendo. Justo antes del cambio se detiene la uart y
+ * después se reprograma el divisor, se vuelve a arrancar y se reanuda la
+ * transmisión, igual que si se cancela el cambio
+ * @param event		Fase del cambio
+ * @param old_freq	Frecuencia anterior
+ * @param new_freq	Frecuencia nueva
+ * @return			Distinto de cero para rechazar el cambio
+ */
+static int32_t uart_clock_notifier(crm_clock_event_t event, uint32_t old_freq, uint32_t new_freq){
+	uint32_t uart, token;
+
+	if(event == crm_clock_pre_change){
+		/* Se rechaza antes de suspender nada */
+		for(uart = 0; uart < uart_max; uart++){
+			if(uart_baudrates[uart] > (new_freq >> 4)){
+				return -1;
+			}
+		}
+	}
+
+	for(uart = 0; uart < uart_max; uart++){
+		if(uart_baudrates[uart] == 0){
+			continue;
+		}
+
+		if(event == crm_clock_pre_change){
+			/* Con la interrupción de la uart enmascarada, para que uart_isr */
+			/* no esté a medias de llenar la cola hardware */
+			token = itc_critical_enter_mask(1 << (itc_src_uart1 + uart));
+			uart_tx_suspended[uart] = 1;
+			REG_SET_BITS(uart_regs[uart]->CON, UART_CON_MTXR);
+			itc_critical_exit(token);
+
+			/* Esperamos a que salga la cola hardware y el último carácter */
+			while(uart_tx_free(uart) < 32);
+			tmr_delay_us(10 * 1000000 / uart_baudrates[uart] + 1);
+		}
+		else if(event == crm_clock_switch){
+			REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_TXE | UART_CON_RXE);
+		}
+		else if(event == crm_clock_post_change){
+			uart_program_baudrate(uart);
+			REG_SET_BITS(uart_regs[uart]->CON, UART_CON_TXE | UART_CON_RXE);
+			uart_tx_resume(uart);
+		}
+		else{
+			token = itc_critical_enter_mask(1 << (itc_src_uart1 + uart));
+			uart_tx_resume(uart);
+			itc_critical_exit(token);
+		}
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
 /**
  * Inicializa una uart
  * @param uart	Identificador de la uart
@@ -175,19 +292,21 @@ int32_t uart_init(uart_id_t uart, uint32_t br, const char *name){
 		return -1;
 	}
 
-	uint32_t mod = 9999;
-	uint32_t inc = br * mod / (CPU_FREQ >> 4);
-
 	/* Fijamos los parámetros por defecto y deshabilitamos la uart */
 	/* La uart debe estar deshabilitada para fijar la frecuencia */
-	uart_regs[uart]->CON = (1 << 13) | (1 << 14);
+	REG_WRITE(uart_regs[uart]->CON, UART_CON_MTXR | UART_CON_MRXR);
 
-	/* Fijamos la frecuencia, asumimos un oversampling de 8x */
-	uart_regs[uart]->BR = ( inc << 16 ) | mod;
+	/* La frecuencia se recalcula en cada cambio de reloj del sistema */
+	if(!uart_notifier_registered){
+		uart_notifier_registered = !crm_register_notifier(uart_clock_notifier);
+	}
+
+	uart_baudrates[uart] = br;
+	uart_program_baudrate(uart);
 
 	/* Habilitamos la uart. En el MC1322x hay que habilitar el */
 	/* periférico antes fijar el modo de funcionamiento de sus pines */
-	uart_regs[uart]->CON |= (1 << 0) | (1 << 1);
+	REG_SET_BITS(uart_regs[uart]->CON, UART_CON_TXE | UART_CON_RXE);
 
 	/* Cambiamos el modo de funcionamiento de los pines */
 	gpio_set_pin_func(uart_pins[uart].tx, gpio_func_alternate_1);
@@ -206,8 +325,8 @@ int32_t uart_init(uart_id_t uart, uint32_t br, const char *name){
 	circular_buffer_init(&uart_circular_tx_buffers[uart], (uint8_t *) uart_tx_buffers[uart], sizeof(uart_tx_buffers[uart]));
 
 	/* Programamos cuando generar las interrupciones */
-	uart_regs[uart]->TxLevel = 31;	/* cola envio vacia */
-	uart_regs[uart]->RxLevel = 1;	/* llega un byte */
+	REG_WRITE(uart_regs[uart]->TxCON, REG_VAL(UART_TXCON_LEVEL, 31));	/* cola envio vacia */
+	REG_WRITE(uart_regs[uart]->RxCON, REG_VAL(UART_RXCON_LEVEL, 1));	/* llega un byte */
 
 	/* Habilitamos las interrupciones de la uart */
 	/* en el controlador de interrupciones del sistema */
@@ -220,7 +339,7 @@ int32_t uart_init(uart_id_t uart, uint32_t br, const char *name){
 	uart_callbacks[uart].rx_callback = NULL;
 
 	/* Habilitamos interrupciones en la recepción */
-	uart_regs[uart]->mRxR = 0;
+	REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_MRXR);
 
 	/* Registramos el dispositivo. Implementación del driver de nivel 2 */
 	bsp_register_dev (name, uart, NULL, NULL, uart_receive, uart_send, NULL, NULL, NULL);
@@ -237,22 +356,24 @@ int32_t uart_init(uart_id_t uart, uint32_t br, const char *name){
  * @param c		El carácter
  */
 void uart_send_byte(uart_id_t uart, uint8_t c){
-	uart_regs[uart]->mTxR = 1;
+	REG_SET_BITS(uart_regs[uart]->CON, UART_CON_MTXR);
 
 	if(!circular_buffer_is_empty(&uart_circular_tx_buffers[uart])){
-		while(uart_regs[uart]->Tx_fifo_addr_diff > 0){
-			uart_regs[uart]->Tx_data = circular_buffer_read(&uart_circular_tx_buffers[uart]);
+		while(uart_tx_free(uart) > 0){
+			REG_WRITE(uart_regs[uart]->DATA, circular_buffer_read(&uart_circular_tx_buffers[uart]));
 		}
 	}
 
 	/* Esperamos a poder transmitir */
 	// Espera hasta que el número de huecos en la cola de escritura sea mayor que 0
-	while(uart_regs[uart]->Tx_fifo_addr_diff == 0);
+	while(uart_tx_free(uart) == 0);
 
 	/* Escribimos el carácter en la cola HW de la uart */
-	uart_regs[uart]->Tx_data = c;
+	REG_WRITE(uart_regs[uart]->DATA, c);
 
-	uart_regs[uart]->mTxR = 0;
+	if(!uart_tx_suspended[uart]){
+		REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_MTXR);
+	}
 }
 
 /*****************************************************************************/
@@ -265,7 +386,7 @@ void uart_send_byte(uart_id_t uart, uint8_t c){
  */
 uint8_t uart_receive_byte(uart_id_t uart){
 	uint8_t value;
-	uart_regs[uart]->mRxR = 1;
+	REG_SET_BITS(uart_regs[uart]->CON, UART_CON_MRXR);
 
 	if(!circular_buffer_is_empty(&uart_circular_rx_buffers[uart])){
 		value = circular_buffer_read(&uart_circular_tx_buffers[uart]);
@@ -273,13 +394,13 @@ uint8_t uart_receive_byte(uart_id_t uart){
 	else{
 		/* Esperamos a poder recibir */
 		// Espera hasta que el número de bytes en la cola de lectura sea mayor que 0
-		while(uart_regs[uart]->Rx_fifo_addr_diff == 0);
+		while(uart_rx_count(uart) == 0);
 
 		/* Leemos el byte */
-		value = uart_regs[uart]->Rx_data;
+		value = (uint8_t) REG_READ(uart_regs[uart]->DATA);
 	}
 
-	uart_regs[uart]->mRxR = 0;
+	REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_MRXR);
 
 	return value;
 }
@@ -289,6 +410,9 @@ uint8_t uart_receive_byte(uart_id_t uart){
 /**
  * Transmisión de bytes
  * Implementación del driver de nivel 1. La llamada es no bloqueante y se realiza mediante interrupciones
+ * Se puede llamar desde las tareas, desde el trabajo diferido y desde las
+ * callbacks de la propia uart. Los manejadores de otras fuentes deben
+ * diferir el envío, porque su interrupción no se enmascara durante la copia
  * @param uart	Identificador de la uart
  * @param buf	Búfer con los caracteres
  * @param count	Número de caracteres a escribir
@@ -310,24 +434,47 @@ ssize_t uart_send(uint32_t uart, char *buf, size_t count){
 	}
 
 	uint32_t written = 0;
+	uint32_t locked = task_in_thread();
+	uint32_t token, chunk, full = 0;
+
+	/* Los manejadores escriben sin el mutex: no pueden bloquearse */
+	if(locked){
+		mutex_lock(&uart_tx_mutex[uart], TASK_WAIT_FOREVER);
+	}
 
 	/*
-		Deshabilitamos la petición de interrupciones del transmisor de la UART
-		mientras realizamos la copia de datos al búfer circular
+		El búfer circular sólo admite un productor: la copia se hace por
+		trozos con la interrupción de la uart y el trabajo diferido
+		enmascarados, para que ni uart_isr ni otro productor en modo SYS
+		lo modifiquen a medias
 	*/
-	uart_regs[uart]->mTxR = 1;
+	while(count > 0 && !full){
+		token = itc_critical_enter_mask((1 << (itc_src_uart1 + uart)) | (1 << SOFTIRQ_SRC));
 
-	while(!circular_buffer_is_full(&uart_circular_tx_buffers[uart]) && count > 0){
-		circular_buffer_write(&uart_circular_tx_buffers[uart], *buf++);
+		for(chunk = 0; chunk < UART_SEND_CHUNK && count > 0; chunk++){
+			if(circular_buffer_is_full(&uart_circular_tx_buffers[uart])){
+				full = 1;
+				break;
+			}
 
-		written++;
-		count--;
+			circular_buffer_write(&uart_circular_tx_buffers[uart], *buf++);
+
+			written++;
+			count--;
+		}
+
+		/* Hay datos: uart_isr debe pasarlos a la cola hardware, salvo */
+		/* durante un cambio de frecuencia */
+		if(!uart_tx_suspended[uart]){
+			REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_MTXR);
+		}
+
+		itc_critical_exit(token);
 	}
 
-	/*
-		Volvemos a habilitarla una vez que la copia ha terminado
-	*/
-	uart_regs[uart]->mTxR = 0;
+	if(locked){
+		mutex_unlock(&uart_tx_mutex[uart]);
+	}
 
 	return written;
 }
@@ -362,7 +509,7 @@ ssize_t uart_receive(uint32_t uart, char *buf, size_t count){
 	/*
 		Región crítica para el acceso al búfer circular de recepción
 	*/
-	uart_regs[uart]->mRxR = 1;
+	REG_SET_BITS(uart_regs[uart]->CON, UART_CON_MRXR);
 
 	while(!circular_buffer_is_empty(&uart_circular_rx_buffers[uart]) && count > 0){
 		*buf++ = circular_buffer_read(&uart_circular_rx_buffers[uart]);
@@ -374,7 +521,7 @@ ssize_t uart_receive(uint32_t uart, char *buf, size_t count){
 	/*
 		Fin de región crítica
 	*/
-	uart_regs[uart]->mRxR = 0;
+	REG_CLEAR_BITS(uart_regs[uart]->CON, UART_CON_MRXR);
 
 	return read;
 }
@@ -428,6 +575,10 @@ int32_t uart_set_send_callback(uart_id_t uart, uart_callback_t func){
  * Cada isr llamará a este manejador indicando la uart en la que se ha
  * producido la interrupción.
  * Lo declaramos inline para reducir la latencia de la isr
+ * STAT se lee una sola vez y RxRdy y TxRdy se comprueban sobre esa lectura.
+ * El ahorro de ciclos frente a los campos de bits no se ha medido en la
+ * placa: se mide comparando con ITC_STATS la duración de itc_src_uart1 y
+ * itc_src_uart2 con uno y otro código
  * @param uart	Identificador de la uart
  */
 static inline void uart_isr(uart_id_t uart){
@@ -435,13 +586,13 @@ static inline void uart_isr(uart_id_t uart){
 
 	/* Si la interrupción es por un error, la reconocemos */
 	/* Limpiamos los bits de error, de momento no gestionamos errores */
-	status = uart_regs[uart]->STAT;
+	status = REG_READ(uart_regs[uart]->STAT);
 
 	/* Si la interrupción es del receptor */
-	if (uart_regs[uart]->RxRdy){
+	if (status & UART_STAT_RXRDY){
 		/* Mandamos al búfer todos los caracteres de la cola HW que podamos */
-		while (!circular_buffer_is_full(&uart_circular_rx_buffers[uart]) && (uart_regs[uart]->Rx_fifo_addr_diff > 0)){
-			circular_buffer_write (&uart_circular_rx_buffers[uart], uart_regs[uart]->Rx_data);	/* Recibimos un carácter */
+		while (!circular_buffer_is_full(&uart_circular_rx_buffers[uart]) && (uart_rx_count(uart) > 0)){
+			circular_buffer_write (&uart_circular_rx_buffers[uart], (uint8_t) REG_READ(uart_regs[uart]->DATA));	/* Recibimos un carácter */
 		}
 
 		/* Llamamos a la función callback para que la aplicación se haga cargo de los datos del búfer */
@@ -451,15 +602,15 @@ static inline void uart_isr(uart_id_t uart){
 
 		/* Si el buffer circular está lleno, no podemos aceptar más datos */
 		if (circular_buffer_is_full (&uart_circular_rx_buffers[uart])){
-			uart_regs[uart]->mRxR =	1;	/* Enmascaramos las interrupciones del receptor para que no nos ofrezca más datos */
+			REG_SET_BITS(uart_regs[uart]->CON, UART_CON_MRXR);	/* Enmascaramos las interrupciones del receptor para que no nos ofrezca más datos */
 		}
 	}
 
-	/* Si la interrupción es del transmisor */
-	if (uart_regs[uart]->TxRdy){
+	/* Si la interrupción es del transmisor y no hay un cambio de frecuencia en curso */
+	if ((status & UART_STAT_TXRDY) && !uart_tx_suspended[uart]){
 		/* Mandamos a la cola HW todos los caracteres del búfer que podamos */
-		while (!circular_buffer_is_empty(&uart_circular_tx_buffers[uart]) && (uart_regs[uart]->Tx_fifo_addr_diff > 0)){
-			uart_regs[uart]->Tx_data = circular_buffer_read (&uart_circular_tx_buffers[uart]);	/* Transmitimos un carácter */
+		while (!circular_buffer_is_empty(&uart_circular_tx_buffers[uart]) && (uart_tx_free(uart) > 0)){
+			REG_WRITE(uart_regs[uart]->DATA, circular_buffer_read (&uart_circular_tx_buffers[uart]));	/* Transmitimos un carácter */
 		}
 
 		/* Llamamos a la función callback por si la aplicación quiere mandar más datos al búfer */
@@ -469,7 +620,7 @@ static inline void uart_isr(uart_id_t uart){
 
 		/* Si el búfer está vacío es que no hay mas datos */
 		if (circular_buffer_is_empty (&uart_circular_tx_buffers[uart])){
-			uart_regs[uart]->mTxR = 1;	/* Enmascaramos las interrupciones del transmisor para que no nos pida más datos */
+			REG_SET_BITS(uart_regs[uart]->CON, UART_CON_MTXR);	/* Enmascaramos las interrupciones del transmisor para que no nos pida más datos */
 		}
 	}
 }
@@ -16,8 +16,14 @@ static void bsp_excep_init( void ){
 	/* Inicializamos los manejadores de excepción */
 	excep_init();
 
+	/* Inicializamos las llamadas al sistema */
+	swi_init();
+
 	/* Inicializamos el controlador de interrupciones */
 	itc_init ();
+
+	/* Inicializamos el trabajo diferido, que usa una fuente del ITC */
+	softirq_init ();
 }
 
 /*****************************************************************************/
@@ -27,6 +33,28 @@ static void bsp_excep_init( void ){
  * Esta función se debe llamar después de  bsp_int_init().
  */
 static void bsp_sys_init( void ){
+	/* Inicialización del reloj del sistema, antes que los drivers que */
+	/* dependen de su frecuencia */
+	crm_init();
+
+	/* Inicialización de los temporizadores */
+	tmr_init();
+
+	/* Inicialización de los temporizadores software, que usan una alarma */
+	systimer_init();
+
+	/* Inicialización del planificador: main será la primera tarea */
+	task_init();
+
+	/* Inicialización del bucle de eventos */
+	event_init();
+
+	/* Inicialización de la medida de la carga de la CPU */
+	cpuload_init();
+
+	/* Inicialización de los pools de bloques */
+	pool_init();
+
 	/* Inicialización de las UARTs */
 	uart_init(UART1_ID, UART1_BAUDRATE, UART1_NAME);
 	uart_init(UART2_ID, UART2_BAUDRATE, UART2_NAME);
@@ -62,6 +90,9 @@ void bsp_init (void){
 	/* Inicializamos las excepciones */
 	bsp_excep_init();
 
+	/* Inicializamos el heap, antes de que nadie reserve memoria */
+	heap_init();
+
 	/* Inicializamos los drivers de los dispositivos */
 	bsp_sys_init();
 
@@ -18,6 +18,9 @@
 	@ Valor para inicializar las pilas
 	.set _STACK_FILLER, 0xdeadbeef
 
+	@ Dirección base del controlador de interrupciones
+	.set _ITC_BASE, 0x80020000
+
 /* 
 	Sección de código de arranque
 */
@@ -88,6 +91,19 @@ _fiq_handler:
 	.type	_start, %function
 _start:
 
+/* 
+	Pintamos las pilas con _STACK_FILLER para poder medir su uso máximo
+	(stack.h). Aún no hay pila, así que sólo se usan registros
+*/
+
+	ldr	r0, =_stacks_bottom
+	ldr	r1, =_stacks_top
+	ldr	r2, =_STACK_FILLER
+1:
+	cmp	r0, r1
+	strlo	r2, [r0], #4
+	blo	1b
+
 /* 
 	Inicializamos las pilas para cada modo
 */
@@ -108,6 +124,11 @@ _start:
 	msr	cpsr_c, #(_FIQ_MODE | _IRQ_DISABLE | _FIQ_DISABLE)
 	ldr	sp, =_fiq_stack_top
 
+	@ Registros banqueados del modo FIQ que usa el despachador de FIQ
+	@ (excep_fiq_handler) para no tener que cargarlos en cada interrupción
+	ldr	r8, =_ITC_BASE
+	ldr	r9, =itc_handlers
+
 	@ Pila del modo IRQ
 	msr	cpsr_c, #(_IRQ_MODE | _IRQ_DISABLE | _FIQ_DISABLE)
 	ldr	sp, =_irq_stack_top
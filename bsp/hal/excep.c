@@ -4,6 +4,8 @@
  */
 
 #include "stdlib.h"
+#include <stdio.h>
+#include <string.h>
 #include "system.h"
 
 /*****************************************************************************/
@@ -13,13 +15,83 @@
  */
 extern volatile excep_handler_t _excep_handlers[excep_max];
 
+/**
+ * Registro de fallo que rellenan los manejadores en ensamblador.
+ * Está en la sección .noinit para que sobreviva a un reinicio software
+ */
+excep_fault_t excep_fault_record __attribute__ ((section (".noinit")));
+
+/**
+ * Copia del fallo registrado antes del último reinicio
+ */
+static excep_fault_t excep_last_fault;
+static uint32_t excep_last_fault_valid;
+
 /*****************************************************************************/
 
 /**
  * Inicializa los manejadores de excepción
  */
 void excep_init(){
-	excep_set_handler(excep_irq, excep_nonnested_irq_handler);
+	/* Recuperamos el fallo anterior al reinicio, si lo hubo */
+	if(excep_fault_record.magic == EXCEP_FAULT_MAGIC){
+		memcpy(&excep_last_fault, &excep_fault_record, sizeof(excep_fault_t));
+		excep_last_fault_valid = 1;
+	}
+	else{
+		excep_last_fault_valid = 0;
+	}
+
+	excep_fault_record.magic = 0;
+
+	excep_set_handler(excep_undef, excep_undef_fault_handler);
+	excep_set_handler(excep_pabt, excep_pabt_fault_handler);
+	excep_set_handler(excep_dabt, excep_dabt_fault_handler);
+	excep_set_handler(excep_irq, excep_nonnested_irq_handler_asm);
+	excep_set_handler(excep_fiq, excep_fiq_handler);
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el fallo registrado antes del último reinicio
+ * @return	Un puntero al registro del fallo o NULL si no hubo ninguno
+ */
+const excep_fault_t * excep_get_last_fault(){
+	return excep_last_fault_valid ? &excep_last_fault : NULL;
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime un registro de fallo por la salida estándar, en el formato que
+ * interpreta tools/fault-decode
+ * @param fault	Registro del fallo
+ */
+void excep_print_fault(const excep_fault_t *fault){
+	static const char * const names[excep_max] = {
+		"reset", "undef", "swi", "pabt", "dabt", "rsv", "irq", "fiq"
+	};
+	uint32_t i, j;
+
+	iprintf("FAULT %s pc=0x%08lx cpsr=0x%08lx\r\n",
+			fault->type < excep_max ? names[fault->type] : "?", fault->pc, fault->cpsr);
+
+	for(i = 0; i < 13; i++){
+		iprintf("REG r%lu=0x%08lx\r\n", i, fault->r[i]);
+	}
+
+	iprintf("REG sp=0x%08lx\r\nREG lr=0x%08lx\r\n", fault->sp, fault->lr);
+
+	for(i = 0; i < EXCEP_FAULT_STACKS; i++){
+		iprintf("STACK mode=0x%02lx sp=0x%08lx", fault->stacks[i].mode, fault->stacks[i].sp);
+
+		for(j = 0; j < EXCEP_FAULT_STACK_WORDS; j++){
+			iprintf(" 0x%08lx", fault->stacks[i].words[j]);
+		}
+
+		iprintf("\r\n");
+	}
 }
 
 /*****************************************************************************/
@@ -0,0 +1,329 @@
+/*
+	Sistemas Empotrados
+	Manejadores de excepción en ensamblador para el MC1322x
+*/
+
+	.set _IRQ_DISABLE, 0x80
+	.set _FIQ_DISABLE, 0x40
+
+	.set _USR_MODE, 0x10
+	.set _FIQ_MODE, 0x11
+	.set _IRQ_MODE, 0x12
+	.set _SVC_MODE, 0x13
+	.set _SYS_MODE, 0x1F
+
+	@ Tipos de excepción (excep_t) y registro de fallo (excep_fault_t)
+	.set _EXCEP_UNDEF, 1
+	.set _EXCEP_PABT, 3
+	.set _EXCEP_DABT, 4
+	.set _FAULT_MAGIC, 0xfa17c0de
+	.set _FAULT_TYPE, 4
+	.set _FAULT_PC, 8
+	.set _FAULT_CPSR, 12
+	.set _FAULT_R, 16
+	.set _FAULT_SP, 68
+	.set _FAULT_LR, 72
+	.set _FAULT_STACKS, 76
+	.set _FAULT_STACK_WORDS, 8
+	.set _FAULT_NSTACKS, 4
+
+	@ Registros del ITC usados por los despachadores
+	.set _ITC_BASE, 0x80020000
+	.set _ITC_NIVECTOR, 0x28
+	.set _ITC_FIVECTOR, 0x2C
+
+	@ Llamadas al sistema (ver swi.h)
+	.set _SWI_FAST_MAX, 3
+	.set _SWI_MAX, 16
+
+/*
+	Sección de código
+*/
+	.code 32
+	.text
+
+/*
+	Manejador de interrupciones normales no anidadas
+	Lee nivector y salta directamente al manejador registrado en itc_handlers,
+	sin pasar por un manejador en C ni por itc_service_normal_interrupt.
+	Sólo se apilan los registros que el AAPCS permite modificar al manejador
+	(r0-r3, r12) y la dirección de retorno. El manejador recibe:
+		r0: fuente atendida (itc_src_t)
+		r1: marco con el contexto interrumpido (excep_irq_frame_t *)
+	Latencia desde el vector hasta la primera instrucción del manejador.
+	Son estimaciones, no medidas, contando los tiempos del ARM7TDMI en RAM
+	sin estados de espera:
+		Este despachador:                               ~30 ciclos
+		excep_nonnested_irq_handler + itc_service_*:    ~41 ciclos
+	y el retorno pasa de ~15 a ~9 ciclos. Los accesos al ITC pueden añadir
+	estados de espera del bus de periféricos en ambos casos. Para medirla en
+	la placa se compila con ITC_STATS, se fuerza la fuente con
+	itc_force_interrupt y se compara la latencia de itc_stats_print con uno
+	y otro despachador (ambas incluyen la lectura del reloj de la medida)
+	Si el manejador ha preparado una tarea más prioritaria o ha vencido la
+	rodaja de tiempo (task_need_resched), la salida hacia modo USER pasa por
+	task_switch_context. Se comprueba el modo de retorno y no la pila: sólo
+	las tareas se ejecutan en modo USER, y las IRQ anidadas interrumpen el
+	trabajo diferido en modo SYS (excep_nested_call)
+*/
+	.align	4
+	.globl	excep_nonnested_irq_handler_asm
+	.type	excep_nonnested_irq_handler_asm, %function
+excep_nonnested_irq_handler_asm:
+	sub	lr, lr, #4						@ Dirección de retorno
+	stmfd	sp!, {r0-r3, r12, lr}
+	ldr	r0, =_ITC_BASE
+	ldr	r0, [r0, #_ITC_NIVECTOR]		@ r0 <- fuente normal pendiente de más prioridad
+	ldr	r2, =itc_handlers
+	ldr	r2, [r2, r0, lsl #2]			@ r2 <- itc_handlers[r0]
+	mov	r1, sp							@ r1 <- marco de la interrupción
+	mov	lr, pc
+	bx	r2
+	ldr	r0, =task_need_resched
+	ldr	r0, [r0]
+	cmp	r0, #0
+	bne	excep_irq_resched
+	ldmfd	sp!, {r0-r3, r12, pc}^		@ Retorno restaurando cpsr
+
+excep_irq_resched:
+	mrs	r0, spsr
+	and	r0, r0, #0x1F
+	cmp	r0, #_USR_MODE
+	beq	excep_irq_switch
+	ldmfd	sp!, {r0-r3, r12, pc}^		@ No volvemos a una tarea: retorno normal
+
+excep_irq_switch:
+	ldmfd	sp!, {r0-r3, r12, lr}
+	b	task_switch_context				@ Retorna a la tarea elegida
+
+	.size	excep_nonnested_irq_handler_asm, .-excep_nonnested_irq_handler_asm
+
+/*
+	Manejador de interrupciones rápidas (FIQ)
+	Usa los registros r8-r12 propios del modo FIQ, por lo que no necesita
+	guardarlos. crt0.s deja precargados en ellos:
+		r8_fiq: dirección base del ITC
+		r9_fiq: dirección de la tabla de manejadores (itc_handlers)
+	Sólo se apilan los registros no banqueados que un manejador en C puede
+	modificar según el AAPCS (r0-r3) y lr_fiq, que se pierde en la llamada.
+	r12_fiq se apila sólo para que sean 6 palabras y la pila siga alineada
+	a 8 bytes al llamar al manejador, como exige el AAPCS.
+	Las FIQ no se anidan, así que no es necesario guardar spsr_fiq
+*/
+	.align	4
+	.globl	excep_fiq_handler
+	.type	excep_fiq_handler, %function
+excep_fiq_handler:
+	ldr	r10, [r8, #_ITC_FIVECTOR]	@ r10 <- fuente rápida pendiente de más prioridad
+	ldr	r11, [r9, r10, lsl #2]		@ r11 <- itc_handlers[r10]
+	stmfd	sp!, {r0-r3, r12, lr}		@ Número par de palabras: sp alineado a 8
+	mov	r0, r10						@ El manejador recibe la fuente atendida en r0
+	mov	lr, pc
+	bx	r11
+	ldmfd	sp!, {r0-r3, r12, lr}
+	subs	pc, lr, #4					@ Retorno de la FIQ restaurando cpsr
+
+	.size	excep_fiq_handler, .-excep_fiq_handler
+
+/*
+	Ejecuta una función en modo SYS con las interrupciones habilitadas
+	Se llama desde un manejador de IRQ para que el resto de su trabajo pueda
+	ser interrumpido. Guarda en la pila IRQ spsr_irq y lr_irq, que una IRQ
+	anidada sobrescribiría
+	El modo SYS comparte sp con el modo USER, así que la función se ejecuta
+	en una pila propia (_softirq_stack_top, econotag.ld) y no en la de la
+	tarea interrumpida, que no tiene por qué tener sitio para ella. En esa
+	pila se guardan sp y lr del modo SYS. Si ya se está en esa pila (una
+	llamada anidada) se sigue en ella
+		r0: función a ejecutar
+*/
+	.align	4
+	.globl	excep_nested_call
+	.type	excep_nested_call, %function
+excep_nested_call:
+	mrs	r12, spsr
+	stmfd	sp!, {r12, lr}					@ spsr_irq y lr_irq
+	msr	cpsr_c, #_SYS_MODE				@ Modo SYS con IRQ y FIQ habilitadas
+	mov	r12, sp							@ r12 <- sp del código interrumpido
+	ldr	r1, =_softirq_stack_bottom
+	ldr	r2, =_softirq_stack_top
+	sub	r3, r12, r1
+	sub	r3, r3, #1
+	sub	r1, r2, r1
+	cmp	r3, r1							@ ¿sp fuera de (bottom, top]?
+	movhs	sp, r2							@ Sí: pasamos a la pila de softirq
+	stmfd	sp!, {r12, lr}					@ sp_sys y lr_sys (8 bytes: alineada a 8)
+	mov	lr, pc
+	bx	r0
+	ldmfd	sp!, {r12, lr}
+	mov	sp, r12							@ Volvemos a la pila interrumpida
+	msr	cpsr_c, #(_IRQ_MODE | _IRQ_DISABLE)	@ Volvemos a modo IRQ
+	ldmfd	sp!, {r12, lr}
+	msr	spsr_cxsf, r12
+	bx	lr
+
+	.size	excep_nested_call, .-excep_nested_call
+
+/*
+	Manejadores de las excepciones undef, pabt y dabt
+	Guardan en excep_fault_record (sección .noinit) el pc que falló, el cpsr,
+	r0-r12, sp y lr del modo que falló y la cima de la pila de cada modo, y
+	cuelgan el sistema. Las pilas de los modos ABT y UND sólo tienen 16 bytes,
+	así que se usa su sp como puntero al registro en lugar de como pila
+	Si el fallo se produce en modo FIQ, r8-r12 son los del modo USER
+*/
+	.align	4
+	.globl	excep_undef_fault_handler
+	.type	excep_undef_fault_handler, %function
+excep_undef_fault_handler:
+	sub	lr, lr, #4						@ lr apunta a la instrucción siguiente
+	ldr	sp, =excep_fault_record + _FAULT_R
+	stmia	sp, {r0-r12}
+	mov	r0, #_EXCEP_UNDEF
+	b	excep_fault_common
+
+	.size	excep_undef_fault_handler, .-excep_undef_fault_handler
+
+	.globl	excep_pabt_fault_handler
+	.type	excep_pabt_fault_handler, %function
+excep_pabt_fault_handler:
+	sub	lr, lr, #4
+	ldr	sp, =excep_fault_record + _FAULT_R
+	stmia	sp, {r0-r12}
+	mov	r0, #_EXCEP_PABT
+	b	excep_fault_common
+
+	.size	excep_pabt_fault_handler, .-excep_pabt_fault_handler
+
+	.globl	excep_dabt_fault_handler
+	.type	excep_dabt_fault_handler, %function
+excep_dabt_fault_handler:
+	sub	lr, lr, #8						@ lr apunta dos instrucciones más allá
+	ldr	sp, =excep_fault_record + _FAULT_R
+	stmia	sp, {r0-r12}
+	mov	r0, #_EXCEP_DABT
+	b	excep_fault_common
+
+	.size	excep_dabt_fault_handler, .-excep_dabt_fault_handler
+
+@ Parte común: r0 = tipo, lr = pc que falló
+excep_fault_common:
+	ldr	r1, =excep_fault_record
+	str	r0, [r1, #_FAULT_TYPE]
+	str	lr, [r1, #_FAULT_PC]
+	mrs	r2, spsr
+	str	r2, [r1, #_FAULT_CPSR]
+	mrs	r4, cpsr						@ r4 <- modo de la excepción
+
+	@ sp y lr del modo que falló (USER se lee desde SYS)
+	and	r3, r2, #0x1F
+	cmp	r3, #_USR_MODE
+	moveq	r3, #_SYS_MODE
+	orr	r3, r3, #(_IRQ_DISABLE | _FIQ_DISABLE)
+	msr	cpsr_c, r3
+	mov	r5, sp
+	mov	r6, lr
+	msr	cpsr_c, r4
+	str	r5, [r1, #_FAULT_SP]
+	str	r6, [r1, #_FAULT_LR]
+
+	@ Cima de la pila de cada modo
+	add	r7, r1, #_FAULT_STACKS
+	ldr	r6, =_stacks_bottom
+	ldr	r8, =excep_fault_modes
+	mov	r9, #_FAULT_NSTACKS
+1:
+	ldmia	r8!, {r3, r10}					@ r3 <- modo, r10 <- tope de su pila
+	orr	r0, r3, #(_IRQ_DISABLE | _FIQ_DISABLE)
+	msr	cpsr_c, r0
+	mov	r5, sp
+	msr	cpsr_c, r4
+	stmia	r7!, {r3, r5}					@ Modo y sp
+	mov	r11, #_FAULT_STACK_WORDS
+2:
+	cmp	r5, r6							@ Sólo leemos dentro de la zona de pilas,
+	cmphs	r10, r5							@ por si sp está corrompido
+	ldrhi	r12, [r5], #4
+	movls	r12, #0
+	str	r12, [r7], #4
+	subs	r11, r11, #1
+	bne	2b
+	subs	r9, r9, #1
+	bne	1b
+
+	@ El registro sólo es válido cuando se escribe la marca
+	ldr	r2, =_FAULT_MAGIC
+	str	r2, [r1]
+
+	b	.								@ Colgamos el sistema
+
+@ Modos cuya pila se guarda y tope de cada una
+	.align	2
+excep_fault_modes:
+	.word	_SYS_MODE, _sys_stack_top
+	.word	_SVC_MODE, _svc_stack_top
+	.word	_IRQ_MODE, _irq_stack_top
+	.word	_FIQ_MODE, _fiq_stack_top
+
+/*
+	Manejador de interrupciones software (llamadas al sistema)
+	Decodifica el número inmediato de la instrucción swi (sólo estado ARM) y:
+		- Atiende directamente las rutas rápidas (swi_num_t < swi_num_fast_max)
+		  modificando spsr_svc, sin tocar la pila
+		- Para el resto llama a swi_handlers[num] con los argumentos en r0-r3
+		  y retorna su resultado en r0
+	r12 y lr se consideran modificados por la llamada (ver swi.h)
+*/
+	.align	4
+	.globl	excep_swi_handler
+	.type	excep_swi_handler, %function
+excep_swi_handler:
+	ldr	r12, [lr, #-4]				@ r12 <- instrucción swi
+	bic	r12, r12, #0xff000000		@ r12 <- número de la llamada
+	cmp	r12, #_SWI_FAST_MAX
+	addlo	pc, pc, r12, lsl #2		@ Salto a la ruta rápida
+	b	swi_table_call
+	b	swi_disable_ints_fast
+	b	swi_restore_ints_fast
+	b	swi_yield_fast
+
+swi_disable_ints_fast:
+	mrs	r12, spsr
+	and	r0, r12, #0xC0
+	mov	r0, r0, lsr #6				@ r0 <- bits I,F del llamador
+	orr	r12, r12, #0xC0				@ I,F <- 1
+	msr	spsr_c, r12
+	movs	pc, lr
+
+swi_restore_ints_fast:
+	mrs	r12, spsr
+	bic	r12, r12, #0xC0
+	and	r0, r0, #3
+	orr	r12, r12, r0, lsl #6		@ Restauramos los bits I,F
+	msr	spsr_c, r12
+	movs	pc, lr
+
+swi_yield_fast:
+	ldr	r12, =swi_yield_handler
+	ldr	r12, [r12]
+	cmp	r12, #0
+	bxne	r12							@ El manejador retorna de la excepción
+	movs	pc, lr						@ Sin planificador no hay nada que hacer
+
+swi_table_call:
+	cmp	r12, #_SWI_MAX
+	bhs	swi_invalid
+	stmfd	sp!, {r4, lr}
+	mrs	r4, spsr					@ Permite llamadas anidadas desde modo SVC
+	ldr	lr, =swi_handlers
+	ldr	r12, [lr, r12, lsl #2]		@ r12 <- swi_handlers[num]
+	mov	lr, pc
+	bx	r12
+	msr	spsr_cxsf, r4
+	ldmfd	sp!, {r4, pc}^				@ Retorno restaurando cpsr
+
+swi_invalid:
+	mvn	r0, #0						@ Llamada inexistente: retornamos -1
+	movs	pc, lr
+
+	.size	excep_swi_handler, .-excep_swi_handler
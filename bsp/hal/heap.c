@@ -0,0 +1,450 @@
+/*
+ * Sistemas operativos empotrados
+ * Heap del sistema con TLSF
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <reent.h>
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Con HEAP_DEBUG, cada bloque empieza por el índice de su punto de llamada
+ * en heap_sites, con relleno para no perder la alineación a 8 bytes
+ */
+#ifdef HEAP_DEBUG
+#define HEAP_PREFIX		8
+#else
+#define HEAP_PREFIX		0
+#endif
+
+/**
+ * Estructura de gestión del heap y estadísticas
+ */
+static tlsf_t heap_tlsf;
+static heap_stats_t heap_stats;
+
+#ifdef HEAP_DEBUG
+
+/**
+ * Reservas pendientes por punto de llamada. La última entrada agrupa los
+ * puntos que no caben
+ */
+static heap_site_t heap_sites[HEAP_DEBUG_SITES + 1];
+
+#endif /* HEAP_DEBUG */
+
+/**
+ * Límite superior del heap, definido en el script de enlazado
+ */
+extern int _heap_end;
+
+/**
+ * Llamada al sistema que reserva la sección .heap (syscalls.c)
+ */
+void * _sbrk (intptr_t incr);
+
+/*****************************************************************************/
+
+/**
+ * Apunta un bloque como reservado
+ * Se debe llamar dentro de una sección crítica
+ * @param block	Bloque de tlsf_malloc
+ * @param site	Punto de llamada
+ * @return		Puntero para el usuario
+ */
+static void *heap_account_alloc(void *block, void *site){
+	uint32_t bytes = tlsf_usable_size(block) - HEAP_PREFIX;
+
+	heap_stats.allocs++;
+	heap_stats.blocks++;
+	heap_stats.bytes += bytes;
+
+#ifdef HEAP_DEBUG
+	{
+		uint32_t i;
+
+		/* Buscamos el punto de llamada o una entrada libre */
+		for(i = 0; i < HEAP_DEBUG_SITES; i++){
+			if(heap_sites[i].site == site ||
+					(heap_sites[i].site == NULL && heap_sites[i].blocks == 0)){
+				break;
+			}
+		}
+
+		if(i < HEAP_DEBUG_SITES){
+			heap_sites[i].site = site;
+		}
+
+		heap_sites[i].blocks++;
+		heap_sites[i].bytes += bytes;
+		*(uint32_t *) block = i;
+	}
+#endif
+
+	return (uint8_t *) block + HEAP_PREFIX;
+}
+
+/*****************************************************************************/
+
+/**
+ * Apunta un bloque como liberado
+ * Se debe llamar dentro de una sección crítica
+ * @param block	Bloque de tlsf_malloc
+ */
+static void heap_account_free(void *block){
+	uint32_t bytes = tlsf_usable_size(block) - HEAP_PREFIX;
+
+	heap_stats.frees++;
+	heap_stats.blocks--;
+	heap_stats.bytes -= bytes;
+
+#ifdef HEAP_DEBUG
+	heap_sites[*(uint32_t *) block].blocks--;
+	heap_sites[*(uint32_t *) block].bytes -= bytes;
+#endif
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva un bloque y lo atribuye a un punto de llamada
+ * @param r		Estructura de reentrada de newlib
+ * @param size	Tamaño en bytes
+ * @param site	Punto de llamada
+ * @return		Puntero alineado a 8 bytes o NULL (ENOMEM)
+ */
+static void *heap_malloc(struct _reent *r, size_t size, void *site){
+	uint32_t token;
+	void *block;
+
+	token = itc_critical_enter();
+
+	block = size <= (size_t) -1 - HEAP_PREFIX ?
+			tlsf_malloc(&heap_tlsf, size + HEAP_PREFIX) : NULL;
+
+	if(block){
+		block = heap_account_alloc(block, site);
+	}
+	else{
+		heap_stats.failures++;
+	}
+
+	itc_critical_exit(token);
+
+	if(block == NULL){
+		r->_errno = ENOMEM;
+	}
+
+	return block;
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera un bloque
+ * @param ptr	Bloque de malloc o NULL
+ */
+static void heap_free(void *ptr){
+	uint8_t *block;
+	uint32_t token;
+
+	if(ptr == NULL){
+		return;
+	}
+
+	block = (uint8_t *) ptr - HEAP_PREFIX;
+
+	token = itc_critical_enter();
+	heap_account_free(block);
+	tlsf_free(&heap_tlsf, block);
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Cambia el tamaño de un bloque. Si no puede hacerlo sin moverlo, la copia
+ * se hace fuera de la sección crítica
+ * @param r		Estructura de reentrada de newlib
+ * @param ptr	Bloque de malloc o NULL
+ * @param size	Nuevo tamaño en bytes
+ * @param site	Punto de llamada, para el bloque nuevo si hay que moverlo
+ * @return		El bloque, quizá en otra dirección, o NULL (ENOMEM). Si
+ * 				falla, el bloque original sigue reservado
+ */
+static void *heap_realloc(struct _reent *r, void *ptr, size_t size, void *site){
+	uint8_t *block, *resized = NULL;
+	uint32_t token, old_bytes, new_bytes;
+	void *new_ptr;
+
+	if(ptr == NULL){
+		return heap_malloc(r, size, site);
+	}
+
+	if(size == 0){
+		heap_free(ptr);
+
+		return NULL;
+	}
+
+	block = (uint8_t *) ptr - HEAP_PREFIX;
+	old_bytes = tlsf_usable_size(block) - HEAP_PREFIX;
+
+	token = itc_critical_enter();
+
+	if(size <= (size_t) -1 - HEAP_PREFIX){
+		resized = tlsf_resize(&heap_tlsf, block, size + HEAP_PREFIX);
+	}
+
+	if(resized){
+		/* El bloque conserva su punto de llamada */
+		new_bytes = tlsf_usable_size(block) - HEAP_PREFIX;
+		heap_stats.bytes += new_bytes - old_bytes;
+
+#ifdef HEAP_DEBUG
+		heap_sites[*(uint32_t *) block].bytes += new_bytes - old_bytes;
+#endif
+	}
+
+	itc_critical_exit(token);
+
+	if(resized){
+		return ptr;
+	}
+
+	new_ptr = heap_malloc(r, size, site);
+
+	if(new_ptr){
+		memcpy(new_ptr, ptr, old_bytes < size ? old_bytes : size);
+		heap_free(ptr);
+	}
+
+	return new_ptr;
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva un bloque a cero y lo atribuye a un punto de llamada
+ * @param r		Estructura de reentrada de newlib
+ * @param n		Número de elementos
+ * @param size	Tamaño de cada elemento
+ * @param site	Punto de llamada
+ * @return		Puntero alineado a 8 bytes o NULL (ENOMEM)
+ */
+static void *heap_calloc(struct _reent *r, size_t n, size_t size, void *site){
+	void *ptr;
+
+	if(size && n > (size_t) -1 / size){
+		r->_errno = ENOMEM;
+
+		return NULL;
+	}
+
+	ptr = heap_malloc(r, n * size, site);
+
+	if(ptr){
+		memset(ptr, 0, n * size);
+	}
+
+	return ptr;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa el heap: obtiene con _sbrk toda la sección .heap de
+ * econotag.ld y la gestiona con TLSF. Desde ese momento malloc, free,
+ * realloc, calloc y sus variantes _r de newlib usan TLSF, en tiempo
+ * constante y dentro de una sección crítica del ITC, así que también se
+ * pueden llamar desde las tareas
+ * Si el heap no se puede inicializar el sistema se detiene con una
+ * instrucción no definida, que queda registrada en excep_fault_record: aún
+ * no hay uart por la que avisar y sin heap fallaría cualquier malloc
+ */
+void heap_init(){
+	void *start = _sbrk(0);
+	intptr_t size = (uint8_t *) &_heap_end - (uint8_t *) start;
+
+	/* El resto de usuarios de _sbrk recibirán ENOMEM */
+	if(_sbrk(size) == (void *) -1 || tlsf_init(&heap_tlsf, start, size) != 0){
+		__builtin_trap();
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva memoria dinámica
+ * @param r		Estructura de reentrada de newlib
+ * @param size	Tamaño en bytes
+ * @return		Puntero alineado a 8 bytes o NULL (ENOMEM)
+ */
+void *_malloc_r(struct _reent *r, size_t size){
+	return heap_malloc(r, size, __builtin_return_address(0));
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera memoria dinámica
+ * @param r		Estructura de reentrada de newlib
+ * @param ptr	Bloque de _malloc_r o NULL
+ */
+void _free_r(struct _reent *r, void *ptr){
+	heap_free(ptr);
+}
+
+/*****************************************************************************/
+
+/**
+ * Cambia el tamaño de un bloque. Si no puede hacerlo sin moverlo, la copia
+ * se hace fuera de la sección crítica
+ * @param r		Estructura de reentrada de newlib
+ * @param ptr	Bloque de _malloc_r o NULL
+ * @param size	Nuevo tamaño en bytes
+ * @return		El bloque, quizá en otra dirección, o NULL (ENOMEM). Si
+ * 				falla, el bloque original sigue reservado
+ */
+void *_realloc_r(struct _reent *r, void *ptr, size_t size){
+	return heap_realloc(r, ptr, size, __builtin_return_address(0));
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva memoria dinámica a cero
+ * @param r		Estructura de reentrada de newlib
+ * @param n		Número de elementos
+ * @param size	Tamaño de cada elemento
+ * @return		Puntero alineado a 8 bytes o NULL (ENOMEM)
+ */
+void *_calloc_r(struct _reent *r, size_t n, size_t size){
+	return heap_calloc(r, n, size, __builtin_return_address(0));
+}
+
+/*****************************************************************************/
+
+/**
+ * Bytes utilizables de un bloque
+ * @param r		Estructura de reentrada de newlib
+ * @param ptr	Bloque de _malloc_r
+ */
+size_t _malloc_usable_size_r(struct _reent *r, void *ptr){
+	return ptr ? tlsf_usable_size((uint8_t *) ptr - HEAP_PREFIX) - HEAP_PREFIX : 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Versiones sin estructura de reentrada, que reemplazan a las de newlib.
+ * Atribuyen la reserva a quien las llama, no a la variante _r
+ */
+void *malloc(size_t size){
+	return heap_malloc(_REENT, size, __builtin_return_address(0));
+}
+
+void free(void *ptr){
+	heap_free(ptr);
+}
+
+void *realloc(void *ptr, size_t size){
+	return heap_realloc(_REENT, ptr, size, __builtin_return_address(0));
+}
+
+void *calloc(size_t n, size_t size){
+	return heap_calloc(_REENT, n, size, __builtin_return_address(0));
+}
+
+size_t malloc_usable_size(void *ptr){
+	return _malloc_usable_size_r(_REENT, ptr);
+}
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas del heap
+ * @param stats	Donde se copian las estadísticas
+ */
+void heap_stats_get(heap_stats_t *stats){
+	uint32_t token = itc_critical_enter();
+
+	*stats = heap_stats;
+	tlsf_stats_get(&heap_tlsf, &stats->tlsf);
+
+	/* Lo que puede pedir malloc, descontado el prefijo de HEAP_DEBUG */
+	stats->tlsf.largest_free = stats->tlsf.largest_free > HEAP_PREFIX ?
+			stats->tlsf.largest_free - HEAP_PREFIX : 0;
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Copia las reservas pendientes de un punto de llamada. Sólo con HEAP_DEBUG
+ * @param index	Entrada, de 0 a HEAP_DEBUG_SITES. La última agrupa los
+ * 				puntos que no caben en la tabla
+ * @param site	Donde se copian las reservas
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t heap_site_get(uint32_t index, heap_site_t *site){
+#ifdef HEAP_DEBUG
+	uint32_t token;
+
+	if(index > HEAP_DEBUG_SITES){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	token = itc_critical_enter();
+	*site = heap_sites[index];
+	itc_critical_exit(token);
+
+	return 0;
+#else
+	errno = ENOSYS;
+
+	return -1;
+#endif
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime el estado de _sbrk y las estadísticas del heap y, con
+ * HEAP_DEBUG, las reservas pendientes de cada punto de llamada, que
+ * sirven para encontrar fugas
+ */
+void heap_stats_print(){
+	sbrk_stats_t sbrk;
+	heap_stats_t stats;
+	heap_site_t site;
+	uint32_t i;
+
+	sbrk_stats_get(&sbrk);
+	heap_stats_get(&stats);
+
+	iprintf("sbrk 0x%08lx-0x%08lx brk 0x%08lx peak 0x%08lx failures %lu\r\n",
+			sbrk.start, sbrk.end, sbrk.brk, sbrk.peak_brk, sbrk.failures);
+	iprintf("heap allocs %lu frees %lu failures %lu blocks %lu bytes %lu\r\n",
+			stats.allocs, stats.frees, stats.failures, stats.blocks, stats.bytes);
+	iprintf("heap %lu used %lu peak %lu free %lu largest %lu frag %lu (per mille)\r\n",
+			stats.tlsf.size, stats.tlsf.used, stats.tlsf.peak, stats.tlsf.free,
+			stats.tlsf.largest_free, stats.tlsf.fragmentation);
+
+	for(i = 0; heap_site_get(i, &site) == 0; i++){
+		if(site.blocks){
+			iprintf("site 0x%08lx blocks %lu bytes %lu\r\n",
+					(uint32_t) site.site, site.blocks, site.bytes);
+		}
+	}
+}
+
+/*****************************************************************************/
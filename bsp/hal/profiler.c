@@ -0,0 +1,221 @@
+/*
+ * Sistemas operativos empotrados
+ * Perfilador estadístico por muestreo del contador de programa
+ */
+
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Muestra: pc interrumpido, lr del código interrumpido y spsr_irq
+ */
+typedef struct{
+	uint32_t pc;
+	uint32_t lr;
+	uint32_t psr;
+} profiler_sample_t;
+
+/**
+ * Cola de muestras. Sólo escribe profiler_sample y sólo lee profiler_flush,
+ * así que basta con que cada uno actualice su índice después de acceder
+ */
+static profiler_sample_t profiler_ring[PROFILER_RING_SIZE];
+static volatile uint32_t profiler_head;
+static volatile uint32_t profiler_tail;
+
+/**
+ * Paquete en curso de envío
+ */
+static uint8_t profiler_packet[4 + PROFILER_BATCH * 9 + 1];
+static uint32_t profiler_packet_len;
+static uint32_t profiler_packet_sent;
+
+/**
+ * Muestras perdidas desde el último paquete y envío pendiente
+ */
+static volatile uint32_t profiler_lost;
+static volatile uint32_t profiler_flush_posted;
+
+static volatile profiler_stats_t profiler_stats;
+
+/*****************************************************************************/
+
+/**
+ * Envía por la UART los paquetes que se puedan sin bloquearse. Si la UART no
+ * admite un paquete completo, el resto se envía en la siguiente llamada
+ * Se ejecuta como trabajo diferido, sin el mutex de la UART: uart_send
+ * protege el búfer enmascarando el trabajo diferido mientras copia
+ * @param arg	No se usa
+ */
+static void profiler_flush(void *arg){
+	uint32_t count, i, sum;
+	profiler_sample_t *sample;
+	ssize_t written;
+	uint8_t *p;
+
+	profiler_flush_posted = 0;
+
+	while(1){
+		if(profiler_packet_sent < profiler_packet_len){
+			written = uart_send(PROFILER_UART_ID, (char *) profiler_packet + profiler_packet_sent,
+					profiler_packet_len - profiler_packet_sent);
+
+			if(written > 0){
+				profiler_packet_sent += written;
+			}
+
+			if(profiler_packet_sent < profiler_packet_len){
+				return;
+			}
+
+			profiler_stats.packets++;
+		}
+
+		count = profiler_head - profiler_tail;
+
+		if(count == 0){
+			return;
+		}
+
+		if(count > PROFILER_BATCH){
+			count = PROFILER_BATCH;
+		}
+
+		p = profiler_packet;
+		*p++ = PROFILER_SYNC0;
+		*p++ = PROFILER_SYNC1;
+		*p++ = count;
+		*p++ = profiler_lost > 255 ? 255 : profiler_lost;
+		profiler_lost = 0;
+
+		for(i = 0; i < count; i++){
+			sample = &profiler_ring[(profiler_tail + i) & (PROFILER_RING_SIZE - 1)];
+
+			*p++ = sample->pc;
+			*p++ = sample->pc >> 8;
+			*p++ = sample->pc >> 16;
+			*p++ = sample->pc >> 24;
+			*p++ = sample->lr;
+			*p++ = sample->lr >> 8;
+			*p++ = sample->lr >> 16;
+			*p++ = sample->lr >> 24;
+			*p++ = sample->psr & 0x3f;
+		}
+
+		profiler_tail += count;
+
+		for(sum = 0, i = 2; i < p - profiler_packet; i++){
+			sum += profiler_packet[i];
+		}
+
+		*p++ = sum;
+
+		profiler_packet_len = p - profiler_packet;
+		profiler_packet_sent = 0;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Manejador del temporizador de muestreo. Como se llama en modo IRQ,
+ * spsr_irq es el cpsr del código interrumpido. Si éste estaba en modo USR o
+ * SYS, su lr es el del banco de usuario, que se lee con stm ^, y en una
+ * función hoja es la dirección de retorno a quien la llamó
+ * @param frame	Contexto interrumpido
+ */
+static void profiler_sample(excep_irq_frame_t *frame){
+	uint32_t head = profiler_head;
+	uint32_t psr, mode, lr = 0;
+
+	if(frame == NULL){
+		profiler_stats.no_frame++;
+		return;
+	}
+
+	if(head - profiler_tail >= PROFILER_RING_SIZE){
+		profiler_stats.dropped++;
+		profiler_lost++;
+		return;
+	}
+
+	asm volatile ("mrs %0, spsr" : "=r" (psr));
+
+	mode = psr & 0x1f;
+
+	if(mode == 0x10 || mode == 0x1f){
+		asm volatile ("stmia %0, {lr}^" : : "r" (&lr) : "memory");
+	}
+
+	profiler_ring[head & (PROFILER_RING_SIZE - 1)].pc = frame->pc;
+	profiler_ring[head & (PROFILER_RING_SIZE - 1)].lr = lr;
+	profiler_ring[head & (PROFILER_RING_SIZE - 1)].psr = psr;
+	profiler_head = head + 1;
+
+	profiler_stats.samples++;
+
+	if(head + 1 - profiler_tail >= PROFILER_BATCH && !profiler_flush_posted){
+		profiler_flush_posted = 1;
+		softirq_post(softirq_priority_low, profiler_flush, NULL);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Arranca el perfilador. Cada muestra se toma en la interrupción del
+ * temporizador PROFILER_TMR_ID y se envía desde un softirq de prioridad baja
+ * Sólo se ven los modos interrumpibles por IRQ: los manejadores que se
+ * ejecutan en modo IRQ no aparecen, pero el trabajo diferido sí
+ * @param hz	Frecuencia de muestreo
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t profiler_start(uint32_t hz){
+	profiler_stop();
+
+	profiler_head = 0;
+	profiler_tail = 0;
+	profiler_packet_len = 0;
+	profiler_packet_sent = 0;
+	profiler_lost = 0;
+	profiler_flush_posted = 0;
+
+	profiler_stats.samples = 0;
+	profiler_stats.dropped = 0;
+	profiler_stats.no_frame = 0;
+	profiler_stats.packets = 0;
+
+	return tmr_start_periodic(PROFILER_TMR_ID, hz, profiler_sample);
+}
+
+/*****************************************************************************/
+
+/**
+ * Detiene el perfilador. Las muestras pendientes se descartan
+ */
+void profiler_stop(){
+	tmr_stop_periodic(PROFILER_TMR_ID);
+
+	profiler_tail = profiler_head;
+}
+
+/*****************************************************************************/
+
+/**
+ * Obtiene las estadísticas del perfilador
+ * @param stats	Estructura donde se almacenan
+ */
+void profiler_get_stats(profiler_stats_t *stats){
+	uint32_t token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	stats->samples = profiler_stats.samples;
+	stats->dropped = profiler_stats.dropped;
+	stats->no_frame = profiler_stats.no_frame;
+	stats->packets = profiler_stats.packets;
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
@@ -0,0 +1,206 @@
+/*
+ * Sistemas operativos empotrados
+ * Trabajo diferido de las interrupciones (softirq)
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Elemento de trabajo diferido
+ */
+typedef struct{
+	softirq_func_t func;
+	void *arg;
+} softirq_work_t;
+
+/*****************************************************************************/
+
+/**
+ * Cola circular de trabajo para una prioridad
+ */
+typedef struct{
+	softirq_work_t work[SOFTIRQ_QUEUE_SIZE];
+	uint32_t start;
+	uint32_t end;
+	uint32_t count;
+} softirq_queue_t;
+
+static volatile softirq_queue_t softirq_queues[softirq_priority_max];
+
+/**
+ * Indica si ya se está ejecutando trabajo diferido
+ */
+static volatile uint32_t softirq_running;
+
+/*****************************************************************************/
+
+/**
+ * Extrae el siguiente trabajo pendiente de mayor prioridad
+ * @param work	Estructura donde se copia el trabajo
+ * @return		1 si había trabajo pendiente o 0 en otro caso
+ */
+static uint32_t softirq_next(softirq_work_t *work){
+	volatile softirq_queue_t *queue;
+	uint32_t priority, found = 0;
+	uint32_t token = itc_critical_enter();
+
+	for(priority = 0; priority < softirq_priority_max && !found; priority++){
+		queue = &softirq_queues[priority];
+
+		if(queue->count){
+			work->func = queue->work[queue->start].func;
+			work->arg = queue->work[queue->start].arg;
+
+			queue->count--;
+			queue->start++;
+
+			if(queue->start == SOFTIRQ_QUEUE_SIZE){
+				queue->start = 0;
+			}
+
+			found = 1;
+		}
+	}
+
+	itc_critical_exit(token);
+
+	return found;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna 1 si queda trabajo pendiente en alguna cola
+ */
+static uint32_t softirq_pending(){
+	uint32_t priority;
+
+	for(priority = 0; priority < softirq_priority_max; priority++){
+		if(softirq_queues[priority].count){
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Ejecuta todo el trabajo pendiente. Se llama en modo SYS con las IRQ
+ * habilitadas mediante excep_nested_call, en la pila de softirq
+ */
+static void softirq_run(void){
+	softirq_work_t work;
+
+	while(softirq_next(&work)){
+		work.func(work.arg);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Manejador de la fuente SOFTIRQ_SRC
+ * Si llega mientras se ejecuta trabajo diferido (porque se ha encolado más
+ * trabajo desde una IRQ anidada) sólo reconoce la interrupción, ya que el
+ * bucle de softirq_run lo ejecutará
+ */
+static void softirq_isr(void){
+	itc_unforce_interrupt(SOFTIRQ_SRC);
+
+	if(softirq_running){
+		return;
+	}
+
+	softirq_running = 1;
+
+	/* Con las IRQ ya deshabilitadas comprobamos que no se ha encolado */
+	/* trabajo después de que softirq_run viese las colas vacías */
+	do{
+		excep_nested_call(softirq_run);
+	}while(softirq_pending());
+
+	softirq_running = 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa las colas de trabajo diferido y registra el manejador de la
+ * fuente de interrupción SOFTIRQ_SRC, que se fuerza para ejecutarlo
+ */
+void softirq_init(){
+	uint32_t priority;
+
+	for(priority = 0; priority < softirq_priority_max; priority++){
+		softirq_queues[priority].start = 0;
+		softirq_queues[priority].end = 0;
+		softirq_queues[priority].count = 0;
+	}
+
+	softirq_running = 0;
+
+	itc_unforce_interrupt(SOFTIRQ_SRC);
+	itc_set_priority(SOFTIRQ_SRC, itc_priority_normal);
+	itc_set_handler(SOFTIRQ_SRC, softirq_isr);
+	itc_enable_interrupt(SOFTIRQ_SRC);
+}
+
+/*****************************************************************************/
+
+/**
+ * Encola trabajo diferido y fuerza la interrupción SOFTIRQ_SRC
+ * El trabajo se ejecuta en modo SYS con las IRQ habilitadas, en orden de
+ * prioridad y, dentro de la misma prioridad, en orden de llegada
+ * Se puede llamar desde los manejadores de interrupción
+ * @param priority	Prioridad del trabajo
+ * @param func		Función a ejecutar
+ * @param arg		Argumento para la función
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t softirq_post(softirq_priority_t priority, softirq_func_t func, void *arg){
+	volatile softirq_queue_t *queue;
+	uint32_t token;
+
+	if(priority >= softirq_priority_max || func == NULL){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	queue = &softirq_queues[priority];
+
+	token = itc_critical_enter();
+
+	if(queue->count == SOFTIRQ_QUEUE_SIZE){
+		itc_critical_exit(token);
+
+		errno = EAGAIN;
+
+		return -1;
+	}
+
+	queue->work[queue->end].func = func;
+	queue->work[queue->end].arg = arg;
+
+	queue->count++;
+	queue->end++;
+
+	if(queue->end == SOFTIRQ_QUEUE_SIZE){
+		queue->end = 0;
+	}
+
+	/* El trabajo se ejecutará en cuanto no haya IRQ más prioritarias */
+	itc_force_interrupt(SOFTIRQ_SRC);
+
+	itc_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,190 @@
+/*
+ * Sistemas operativos empotrados
+ * Medida del uso máximo de las pilas
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Topes y tamaños de las pilas de los modos, definidos en econotag.ld
+ */
+extern uint32_t _sys_stack_top[], _svc_stack_top[], _abt_stack_top[];
+extern uint32_t _und_stack_top[], _irq_stack_top[], _fiq_stack_top[];
+extern uint32_t _softirq_stack_top[];
+extern uint8_t _sys_stack_size[], _svc_stack_size[], _abt_stack_size[];
+extern uint8_t _und_stack_size[], _irq_stack_size[], _fiq_stack_size[];
+extern uint8_t _softirq_stack_size[];
+
+/**
+ * Pila de cada modo. Los tamaños son símbolos absolutos del enlazador: su
+ * dirección es el valor
+ */
+typedef struct{
+	const char *name;
+	uint32_t *top;
+	uint8_t *size;
+} stack_mode_desc_t;
+
+static const stack_mode_desc_t stack_modes[stack_mode_max] = {
+	{ "sys", _sys_stack_top, _sys_stack_size },
+	{ "softirq", _softirq_stack_top, _softirq_stack_size },
+	{ "svc", _svc_stack_top, _svc_stack_size },
+	{ "abt", _abt_stack_top, _abt_stack_size },
+	{ "und", _und_stack_top, _und_stack_size },
+	{ "irq", _irq_stack_top, _irq_stack_size },
+	{ "fiq", _fiq_stack_top, _fiq_stack_size }
+};
+
+/*****************************************************************************/
+
+/**
+ * Pinta una pila con STACK_FILLER. Sólo se debe llamar sobre pilas que no
+ * estén en uso
+ * @param bottom	Dirección más baja de la pila
+ * @param size		Tamaño en bytes
+ */
+void stack_paint(uint32_t *bottom, uint32_t size){
+	uint32_t *end = bottom + size / sizeof(uint32_t);
+
+	while(bottom < end){
+		*bottom++ = STACK_FILLER;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Calcula el uso máximo de una pila pintada buscando, desde su dirección
+ * más baja, la primera palabra que ya no vale STACK_FILLER
+ * Una palabra que se escribió con STACK_FILLER se cuenta como libre
+ * @param bottom	Dirección más baja de la pila
+ * @param size		Tamaño en bytes
+ * @return			Bytes usados. Si es igual al tamaño, la pila ha
+ * 					llegado a su límite y probablemente se ha desbordado
+ */
+uint32_t stack_peak(const uint32_t *bottom, uint32_t size){
+	const uint32_t *p = bottom;
+	const uint32_t *end = bottom + size / sizeof(uint32_t);
+
+	while(p < end && *p == STACK_FILLER){
+		p++;
+	}
+
+	return (uint32_t) (end - p) * sizeof(uint32_t);
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el uso de la pila de un modo del procesador
+ * @param mode	Modo
+ * @param usage	Donde se copia el uso
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t stack_mode_usage(stack_mode_t mode, stack_usage_t *usage){
+	const stack_mode_desc_t *desc;
+
+	if(mode >= stack_mode_max){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	if(usage == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	desc = &stack_modes[mode];
+	usage->size = (uint32_t) desc->size;
+	usage->peak = stack_peak(desc->top - usage->size / sizeof(uint32_t), usage->size);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el uso de la pila de una tarea. La tarea main no tiene pila
+ * propia: usa la del modo SYSTEM
+ * @param task	Tarea
+ * @param usage	Donde se copia el uso
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t stack_task_usage(task_t *task, stack_usage_t *usage){
+	if(task == NULL || usage == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	if(task->stack == NULL){
+		return stack_mode_usage(stack_mode_sys, usage);
+	}
+
+	usage->size = task->stack_size;
+	usage->peak = stack_peak(task->stack, task->stack_size);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Cuenta las pilas, de los modos y de las tareas, que han llegado a su
+ * límite. Se puede llamar periódicamente para detectar un desbordamiento
+ * antes de que corrompa las variables o el heap que hay debajo
+ * @return	Número de pilas llenas
+ */
+uint32_t stack_check(){
+	stack_usage_t usage;
+	uint32_t mode, full = 0;
+	task_t *task;
+
+	for(mode = 0; mode < stack_mode_max; mode++){
+		stack_mode_usage(mode, &usage);
+		full += usage.peak >= usage.size;
+	}
+
+	for(task = task_list(); task; task = task->list_next){
+		if(task->stack){
+			stack_task_usage(task, &usage);
+			full += usage.peak >= usage.size;
+		}
+	}
+
+	return full;
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime el tamaño y el uso máximo de la pila de cada modo y de cada tarea
+ */
+void stack_print(){
+	stack_usage_t usage;
+	uint32_t mode;
+	task_t *task;
+
+	for(mode = 0; mode < stack_mode_max; mode++){
+		stack_mode_usage(mode, &usage);
+		iprintf("%s: peak %lu / %lu bytes%s\r\n", stack_modes[mode].name,
+				usage.peak, usage.size, usage.peak >= usage.size ? " FULL" : "");
+	}
+
+	for(task = task_list(); task; task = task->list_next){
+		if(task->stack){
+			stack_task_usage(task, &usage);
+			iprintf("task %s: peak %lu / %lu bytes%s\r\n", task->name,
+					usage.peak, usage.size, usage.peak >= usage.size ? " FULL" : "");
+		}
+	}
+}
+
+/*****************************************************************************/
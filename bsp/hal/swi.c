@@ -0,0 +1,138 @@
+/*
+ * Sistemas operativos empotrados
+ * Llamadas al sistema mediante interrupciones software (SWI)
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Tabla de manejadores de las llamadas al sistema.
+ * No es estática porque excep_swi_handler la indexa directamente con el
+ * número codificado en la instrucción swi
+ */
+swi_handler_t swi_handlers[swi_num_max];
+
+/**
+ * Manejador de la llamada swi_num_yield, usado por excep_swi_handler
+ */
+void (* swi_yield_handler) (void);
+
+/*****************************************************************************/
+
+/**
+ * Manejador para las llamadas al sistema no asignadas
+ * @return	-1, indicando en errno que la llamada no existe
+ */
+static uint32_t swi_unknown(uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3){
+	errno = ENOSYS;
+
+	return (uint32_t) -1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa la tabla de llamadas al sistema e instala excep_swi_handler
+ */
+void swi_init(){
+	uint32_t i;
+
+	for(i = 0; i < swi_num_max; i++){
+		swi_handlers[i] = swi_unknown;
+	}
+
+	swi_yield_handler = NULL;
+
+	excep_set_handler(excep_swi, excep_swi_handler);
+}
+
+/*****************************************************************************/
+
+/**
+ * Asigna el manejador de una llamada al sistema
+ * @param num		Número de la llamada (desde swi_num_fast_max)
+ * @param handler	Manejador. NULL para anular una asignación anterior
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t swi_set_handler(uint32_t num, swi_handler_t handler){
+	if(num < swi_num_fast_max || num >= swi_num_max){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	swi_handlers[num] = handler ? handler : swi_unknown;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Asigna el manejador de la llamada swi_num_yield
+ * El manejador se ejecuta como manejador de la excepción SWI (modo SVC,
+ * lr_svc con la dirección de retorno y spsr_svc con el cpsr del llamador) y
+ * debe retornar con movs pc, lr. Sin manejador, swi_yield retorna sin más
+ * @param handler	Manejador. NULL para anular una asignación anterior
+ */
+void swi_set_yield_handler(void (* handler) (void)){
+	swi_yield_handler = handler;
+}
+
+/*****************************************************************************/
+
+/**
+ * Deshabilita las IRQ y FIQ desde cualquier modo, incluido USER
+ * @return	El valor de los bits I y F antes de deshabilitar las interrupciones,
+ * 			con el mismo formato que excep_disable_ints
+ */
+inline uint32_t swi_disable_ints(){
+	register uint32_t if_bits asm("r0");
+
+	asm volatile(
+		"swi %[n]"
+		:	"=r" (if_bits)						/* Parámetros de salida */
+		:	[n] "i" (swi_num_disable_ints)		/* Parámetros de entrada */
+		:	"r12", "lr", "cc", "memory"			/* Preservar */
+	);
+
+	return if_bits;
+}
+
+/*****************************************************************************/
+
+/**
+ * Restaura los bits I y F desde cualquier modo, incluido USER
+ * @param if_bits	Valores anteriores de las máscaras, con el mismo formato
+ * 					que excep_restore_ints
+ */
+inline void swi_restore_ints(uint32_t if_bits){
+	register uint32_t bits asm("r0") = if_bits;
+
+	asm volatile(
+		"swi %[n]"
+		:	"+r" (bits)							/* Parámetros de salida */
+		:	[n] "i" (swi_num_restore_ints)		/* Parámetros de entrada */
+		:	"r12", "lr", "cc", "memory"			/* Preservar */
+	);
+}
+
+/*****************************************************************************/
+
+/**
+ * Cede el procesador mediante la llamada swi_num_yield
+ */
+inline void swi_yield(){
+	asm volatile(
+		"swi %[n]"
+		:										/* Parámetros de salida */
+		:	[n] "i" (swi_num_yield)				/* Parámetros de entrada */
+		:	"r12", "lr", "cc", "memory"			/* Preservar */
+	);
+}
+
+/*****************************************************************************/
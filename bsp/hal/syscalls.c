@@ -4,6 +4,7 @@
  */
 
 #include <sys/types.h>
+#include <sys/time.h>
 #include <reent.h>
 #include <errno.h>
 
@@ -16,6 +17,13 @@
  */
 extern int _heap_start, _heap_end;
 
+/**
+ * Límite actual del área reservada, su máximo y peticiones rechazadas
+ */
+static void *current_break = &_heap_start;
+static void *peak_break = &_heap_start;
+static uint32_t sbrk_failures;
+
 /*****************************************************************************/
 
 /**
@@ -27,12 +35,14 @@ extern int _heap_start, _heap_end;
  * 				La condición de error se indica en la variable global errno.
  */
 void * _sbrk(intptr_t incr){
-	static void *current_break = &_heap_start;
-	void *last_break = current_break;
+	void *last_break;
+	uint32_t token;
 
 	/* Anulamos las interrupciones durante el proceso de reserva */
 	/* Comienzo de la sección crítica */
-	itc_disable_ints();
+	token = itc_critical_enter();
+
+	last_break = current_break;
 
 	/* Forzamos a que el incremento sea un múltiplo del tamaño de la palabra */
 	incr = (intptr_t) (((unsigned int)incr + 3) & ~3);
@@ -41,21 +51,44 @@ void * _sbrk(intptr_t incr){
 	if(current_break + incr > (void *) &_heap_end){
 		errno = ENOMEM;
 		last_break = (void *) -1;
+		sbrk_failures++;
 	}
 	else{
 		/* Ampliamos el área reservada para datos dinámicos */
 		current_break += incr;
+
+		if(current_break > peak_break){
+			peak_break = current_break;
+		}
 	}
 
 	/* Volvemos a habilitar las interrupciones */
 	/* Fin de la sección crítica */
-	itc_restore_ints();
+	itc_critical_exit(token);
 
 	return last_break;
 }
 
 /*****************************************************************************/
 
+/**
+ * Copia el estado de _sbrk
+ * @param stats	Donde se copia el estado
+ */
+void sbrk_stats_get(sbrk_stats_t *stats){
+	uint32_t token = itc_critical_enter();
+
+	stats->start = (uint32_t) &_heap_start;
+	stats->end = (uint32_t) &_heap_end;
+	stats->brk = (uint32_t) current_break;
+	stats->peak_brk = (uint32_t) peak_break;
+	stats->failures = sbrk_failures;
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
 /**
  * Abre un dispositivo/fichero
  * @param pathname	Nombre del dispositivo/fichero
@@ -206,6 +239,64 @@ int _fstat(int fd, struct stat *buf){
 
 /*****************************************************************************/
 
+/**
+ * Obtiene la hora actual, contada desde el arranque del sistema
+ * @param tv	Estructura donde se almacena la hora
+ * @param tz	Zona horaria. No se usa
+ * @return		0 en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int _gettimeofday(struct timeval *tv, void *tz){
+	uint64_t us;
+
+	if(tv == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	us = tmr_get_us();
+
+	tv->tv_sec = us / 1000000;
+	tv->tv_usec = us % 1000000;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Obtiene la hora de un reloj POSIX. Ambos relojes cuentan desde el arranque
+ * @param clock_id	CLOCK_REALTIME o CLOCK_MONOTONIC
+ * @param tp		Estructura donde se almacena la hora
+ * @return			0 en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int clock_gettime(clockid_t clock_id, struct timespec *tp){
+	uint64_t ns;
+
+	if(clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	if(tp == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	ns = tmr_get_ns();
+
+	tp->tv_sec = ns / 1000000000;
+	tp->tv_nsec = ns % 1000000000;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
 /**
  * Chequea si el descriptor de fichero corresponde con una terminal
  * @param fd	Descriptor de fichero/dispositivo
@@ -0,0 +1,243 @@
+/*
+ * Sistemas operativos empotrados
+ * Temporizadores software del sistema
+ */
+
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Rueda de temporizadores, que sólo se modifica con la interrupción de los
+ * temporizadores enmascarada
+ */
+static timer_wheel_t systimer_wheel;
+
+/*****************************************************************************/
+
+/**
+ * Función de la rueda para los temporizadores del sistema. Rearranca los
+ * periódicos y llama a la función del usuario, o la difiere
+ * @param arg	El temporizador
+ */
+static void systimer_expire(void *arg){
+	systimer_t *timer = (systimer_t *) arg;
+
+	/* El periodo se cuenta desde el vencimiento previsto, no desde el real, */
+	/* para que no acumule deriva */
+	if(timer->period){
+		timer_wheel_add(&systimer_wheel, &timer->timer, timer->timer.expires + timer->period);
+	}
+
+	if(timer->flags & SYSTIMER_DEFERRED){
+		softirq_post(softirq_priority_normal, timer->callback, timer->arg);
+	}
+	else{
+		timer->callback(timer->arg);
+	}
+}
+
+/*****************************************************************************/
+
+static void systimer_tick(void);
+
+/*****************************************************************************/
+
+/**
+ * Programa la alarma del temporizador hardware para el primer tick en el
+ * que la rueda tiene trabajo, o la cancela si no hay temporizadores activos
+ * Se debe llamar con la interrupción de los temporizadores enmascarada
+ */
+static void systimer_program(void){
+	uint64_t now_us, deadline;
+	uint32_t next;
+
+	if(!timer_wheel_next_expiry(&systimer_wheel, &next)){
+		tmr_cancel_alarm();
+		return;
+	}
+
+	/* El tick de la rueda es de 32 bits: partimos del tick actual de 64 */
+	/* bits para que la alarma sea correcta tras el desbordamiento */
+	now_us = tmr_get_us();
+	deadline = now_us / SYSTIMER_TICK_US;
+	deadline = (deadline + (int32_t) (next - (uint32_t) deadline)) * SYSTIMER_TICK_US;
+
+	/* La alarma va en ticks del hardware, cuya duración depende de la */
+	/* frecuencia actual del bus */
+	tmr_set_alarm(tmr_get_ticks() + (deadline > now_us ? tmr_us_to_ticks(deadline - now_us) : 0),
+			systimer_tick);
+}
+
+/*****************************************************************************/
+
+/**
+ * Reprograma la alarma tras un cambio de frecuencia del bus, porque está en
+ * ticks del hardware
+ * @param event		Fase del cambio
+ * @param old_freq	Frecuencia anterior
+ * @param new_freq	Frecuencia nueva
+ * @return			Siempre 0, no rechaza ningún cambio
+ */
+static int32_t systimer_clock_notifier(crm_clock_event_t event, uint32_t old_freq, uint32_t new_freq){
+	if(event == crm_clock_post_change){
+		systimer_program();
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Alarma del temporizador hardware: procesa todos los ticks transcurridos
+ * desde la anterior, que pueden ser muchos porque no hay tick periódico, y
+ * programa la siguiente
+ */
+static void systimer_tick(void){
+	timer_wheel_advance(&systimer_wheel, systimer_get_ticks());
+
+	systimer_program();
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa los temporizadores del sistema. No hay tick periódico: la
+ * alarma del temporizador hardware se programa para el siguiente vencimiento
+ */
+void systimer_init(){
+	timer_wheel_init(&systimer_wheel, systimer_get_ticks());
+
+	/* Se registra después de tmr_init, así que se notifica después de que */
+	/* el driver de los temporizadores haya actualizado su origen de tiempo */
+	crm_register_notifier(systimer_clock_notifier);
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un temporizador
+ * @param timer		Temporizador
+ * @param callback	Función a llamar al vencer
+ * @param arg		Argumento para la función
+ * @param flags		Opciones SYSTIMER_*
+ */
+void systimer_setup(systimer_t *timer, systimer_callback_t callback, void *arg, uint32_t flags){
+	timer_wheel_timer_init(&timer->timer, systimer_expire, timer);
+
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->period = 0;
+	timer->flags = flags;
+}
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador, o lo rearranca si ya estaba activo
+ * Se puede llamar desde los manejadores de interrupción y desde la propia
+ * función del temporizador
+ * @param timer		Temporizador
+ * @param ms		Milisegundos hasta el primer vencimiento
+ * @param period_ms	Periodo en milisegundos, 0 para un solo disparo
+ */
+void systimer_start(systimer_t *timer, uint32_t ms, uint32_t period_ms){
+	uint32_t token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	timer->period = SYSTIMER_MS_TO_TICKS(period_ms);
+	timer_wheel_add(&systimer_wheel, &timer->timer, systimer_get_ticks() + SYSTIMER_MS_TO_TICKS(ms));
+
+	/* El nuevo temporizador puede vencer antes que la alarma programada */
+	systimer_program();
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador para que venza en un tick absoluto, o lo rearranca
+ * si ya estaba activo. Si el tick ya ha pasado, vence en cuanto se atienda
+ * la alarma
+ * @param timer		Temporizador
+ * @param tick		Tick de systimer_get_ticks
+ * @param period_ms	Periodo en milisegundos, 0 para un solo disparo
+ */
+void systimer_start_at(systimer_t *timer, uint32_t tick, uint32_t period_ms){
+	uint32_t token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	timer->period = SYSTIMER_MS_TO_TICKS(period_ms);
+	timer_wheel_add(&systimer_wheel, &timer->timer, tick);
+
+	systimer_program();
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Detiene un temporizador
+ * Una función diferida ya encolada se ejecuta aunque se detenga el temporizador
+ * @param timer		Temporizador
+ */
+void systimer_stop(systimer_t *timer){
+	uint32_t token = itc_critical_enter_mask(1 << itc_src_tmr);
+
+	timer_wheel_remove(&systimer_wheel, &timer->timer);
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna 1 si el temporizador está activo
+ * @param timer		Temporizador
+ */
+inline uint32_t systimer_is_active(systimer_t *timer){
+	return timer_wheel_is_pending(&timer->timer);
+}
+
+/*****************************************************************************/
+
+/**
+ * Función del temporizador de systimer_sleep_ms
+ * @param arg	Indicador de fin de la espera
+ */
+static void systimer_wakeup(void *arg){
+	*(volatile uint32_t *) arg = 1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Duerme durante un número de milisegundos. Entre interrupciones el
+ * procesador queda en BSP_IDLE_WAIT y no hay tick periódico que lo despierte
+ * No se puede llamar desde los manejadores de interrupción
+ * @param ms	Milisegundos
+ */
+void systimer_sleep_ms(uint32_t ms){
+	volatile uint32_t done = 0;
+	systimer_t timer;
+
+	systimer_setup(&timer, systimer_wakeup, (void *) &done, 0);
+	systimer_start(&timer, ms, 0);
+
+	while(!done){
+		BSP_IDLE_WAIT();
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el tick actual de los temporizadores
+ * @return	Ticks de SYSTIMER_TICK_US microsegundos desde el arranque
+ */
+inline uint32_t systimer_get_ticks(){
+	return (uint32_t) (tmr_get_us() / SYSTIMER_TICK_US);
+}
+
+/*****************************************************************************/
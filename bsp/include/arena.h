@@ -0,0 +1,110 @@
+/*
+ * Sistemas operativos empotrados
+ * Arenas: reserva por desplazamiento y liberación conjunta
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*****************************************************************************/
+
+/**
+ * Arena sobre una zona de memoria. Las reservas avanzan un puntero y no se
+ * liberan una a una: se liberan todas a la vez con arena_reset, o las
+ * hechas desde un punto de control con arena_restore. Sirve para los
+ * objetos de vida corta que mueren juntos, p.ej. los de una orden o una
+ * trama, sin pasar por malloc y free
+ * Una arena pertenece a una sola tarea o manejador: no usa secciones
+ * críticas
+ */
+typedef struct{
+	uint8_t *start;					/* Principio de la zona */
+	uint8_t *end;					/* Fin de la zona */
+	uint8_t *top;					/* Siguiente byte libre */
+	uint8_t *peak;					/* Máximo de top */
+} arena_t;
+
+/**
+ * Punto de control de una arena
+ */
+typedef uint8_t *arena_checkpoint_t;
+
+/*****************************************************************************/
+
+/**
+ * Declara la memoria de una arena, alineada a 8 bytes
+ * @param name	Nombre de la variable
+ * @param bytes	Tamaño en bytes
+ */
+#define ARENA_BUFFER(name, bytes)	static uint64_t name[((bytes) + 7) / 8]
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una arena vacía
+ * @param arena	Arena
+ * @param mem	Zona de memoria, normalmente de ARENA_BUFFER
+ * @param bytes	Tamaño de la zona
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t arena_init (arena_t *arena, void *mem, size_t bytes);
+
+/*****************************************************************************/
+
+/**
+ * Reserva memoria de una arena, alineada a 8 bytes
+ * @param arena	Arena
+ * @param size	Tamaño en bytes
+ * @return		Puntero o NULL si no cabe (ENOMEM)
+ */
+void *arena_alloc (arena_t *arena, size_t size);
+
+/*****************************************************************************/
+
+/**
+ * Retorna un punto de control con el estado actual de la arena. Los puntos
+ * de control se pueden anidar: se restauran en orden inverso
+ * @param arena	Arena
+ */
+arena_checkpoint_t arena_save (arena_t *arena);
+
+/*****************************************************************************/
+
+/**
+ * Libera todo lo reservado desde un punto de control
+ * @param arena			Arena
+ * @param checkpoint	Punto de control de arena_save
+ */
+void arena_restore (arena_t *arena, arena_checkpoint_t checkpoint);
+
+/*****************************************************************************/
+
+/**
+ * Libera todo lo reservado en la arena
+ * @param arena	Arena
+ */
+void arena_reset (arena_t *arena);
+
+/*****************************************************************************/
+
+/**
+ * Retorna los bytes reservados en la arena
+ * @param arena	Arena
+ */
+size_t arena_used (arena_t *arena);
+
+/*****************************************************************************/
+
+/**
+ * Retorna el máximo de bytes reservados en la arena, para dimensionarla
+ * @param arena	Arena
+ */
+size_t arena_peak (arena_t *arena);
+
+/*****************************************************************************/
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,103 @@
+/*
+ * Sistemas operativos empotrados
+ * Adaptadores de las arenas para aplicaciones en C++
+ */
+
+#ifndef __ARENA_ALLOCATOR_H__
+#define __ARENA_ALLOCATOR_H__
+
+#ifndef __cplusplus
+#error "arena_allocator.h sólo se puede usar desde C++"
+#endif
+
+#include <stddef.h>
+
+extern "C" {
+#include "system.h"
+}
+
+/*****************************************************************************/
+
+/**
+ * Asignador con la interfaz mínima de C++11 que reserva de una arena, para
+ * los contenedores cuyos elementos mueren todos a la vez. deallocate no
+ * hace nada: la memoria vuelve a la arena con arena_reset o arena_scope
+ * Sin excepciones, allocate retorna nullptr si la arena está llena
+ */
+template <class T>
+class arena_allocator{
+public:
+	typedef T value_type;
+
+	constexpr arena_allocator(arena_t &arena) : arena(&arena) {}
+
+	template <class U>
+	constexpr arena_allocator(const arena_allocator<U> &other) : arena(other.arena) {}
+
+	/**
+	 * Reserva espacio para n objetos
+	 * @param n	Número de objetos
+	 */
+	T *allocate(size_t n){
+		if(n > (size_t) -1 / sizeof(T)){
+			return nullptr;
+		}
+
+		return static_cast<T *>(arena_alloc(arena, n * sizeof(T)));
+	}
+
+	/**
+	 * No hace nada: la memoria se libera con la arena
+	 */
+	void deallocate(T *, size_t){}
+
+private:
+	template <class U> friend class arena_allocator;
+
+	template <class U, class V>
+	friend bool operator==(const arena_allocator<U> &a, const arena_allocator<V> &b);
+
+	arena_t *arena;					/* Arena de la que se reserva */
+};
+
+/**
+ * Dos asignadores son iguales si reservan de la misma arena
+ */
+template <class U, class V>
+bool operator==(const arena_allocator<U> &a, const arena_allocator<V> &b){
+	return a.arena == b.arena;
+}
+
+template <class U, class V>
+bool operator!=(const arena_allocator<U> &a, const arena_allocator<V> &b){
+	return !(a == b);
+}
+
+/*****************************************************************************/
+
+/**
+ * Punto de control con ámbito: al salir del bloque en el que se declara se
+ * libera todo lo reservado en la arena desde su creación. Los ámbitos se
+ * anidan como los bloques
+ * Los objetos de la arena no se destruyen: deben ser de tipos sin
+ * destructor o destruirse antes a mano
+ */
+class arena_scope{
+public:
+	arena_scope(arena_t &arena) : arena(arena), checkpoint(arena_save(&arena)) {}
+
+	~arena_scope(){
+		arena_restore(&arena, checkpoint);
+	}
+
+	arena_scope(const arena_scope &) = delete;
+	arena_scope &operator=(const arena_scope &) = delete;
+
+private:
+	arena_t &arena;					/* Arena */
+	arena_checkpoint_t checkpoint;	/* Estado al crear el ámbito */
+};
+
+/*****************************************************************************/
+
+#endif /* __ARENA_ALLOCATOR_H__ */
@@ -0,0 +1,312 @@
+/*
+ * Sistemas operativos empotrados
+ * Corrutinas con pila propia para aplicaciones en C++
+ */
+
+#ifndef __COROUTINE_H__
+#define __COROUTINE_H__
+
+#ifndef __cplusplus
+#error "coroutine.h sólo se puede usar desde C++"
+#endif
+
+#include <stdint.h>
+
+extern "C" {
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Funciones en ensamblador (coroutine_asm.s)
+ */
+void coro_swap (uint32_t *save_sp, uint32_t new_sp);
+void coro_entry (void);
+}
+
+/*****************************************************************************/
+
+/**
+ * Corrutina con pila propia. Se deriva de coroutine<bytes> y se implementa
+ * run() como código secuencial que se suspende con yield() o con las
+ * funciones await_*, en lugar de como una máquina de estados de callbacks
+ * El cambio de contexto (coro_swap) guarda 9 palabras en la pila y cuesta
+ * unos 30 ciclos. Cada corrutina ocupa su pila más 36 bytes de estado
+ * Mientras una corrutina se ejecuta, sp_usr está dentro de su pila, así que
+ * en cualquier punto ésta debe poder absorber el marco de TASK_FRAME_WORDS
+ * palabras que guarda task_switch_context al expulsar la tarea. El trabajo
+ * diferido de las IRQ tiene su propia pila y no usa la de la corrutina
+ * Los constructores son constexpr: las corrutinas globales se inicializan
+ * sin constructores dinámicos, que crt0.s no ejecuta
+ */
+class coroutine_base{
+public:
+	/**
+	 * Estados de una corrutina
+	 */
+	enum state_t{
+		state_created = 0,		/* Aún no ha empezado */
+		state_suspended,		/* Suspendida en yield o en un await */
+		state_running,			/* En ejecución */
+		state_finished			/* run() ha retornado */
+	};
+
+	/**
+	 * Ejecuta la corrutina hasta que se suspenda o termine. Se llama desde
+	 * fuera de la corrutina, normalmente desde coroutine_scheduler
+	 * @return	true si la corrutina puede seguir ejecutándose
+	 */
+	bool resume(){
+		if(state == state_finished || state == state_running){
+			return state != state_finished;
+		}
+
+		if(state == state_created){
+			start();
+		}
+
+		state = state_running;
+		coro_swap(&caller_sp, sp);
+
+		return state != state_finished;
+	}
+
+	/**
+	 * Indica si la corrutina ha terminado
+	 */
+	bool finished() const{
+		return state == state_finished;
+	}
+
+	/**
+	 * Indica si la corrutina espera a un tick (await_ms) que aún no ha llegado
+	 * @param now	Tick actual de systimer_get_ticks
+	 */
+	bool sleeping(uint32_t now) const{
+		return delayed && (int32_t) (wake_tick - now) > 0;
+	}
+
+protected:
+	/**
+	 * Crea una corrutina que usará la pila indicada
+	 * @param stack			Pila, alineada a 8 bytes
+	 * @param stack_size	Tamaño de la pila en bytes
+	 */
+	constexpr coroutine_base(uint32_t *stack, uint32_t stack_size) :
+		next(0), sp(0), caller_sp(0), stack(stack), stack_size(stack_size),
+		state(state_created), delayed(false), polling(false), wake_tick(0) {}
+
+	/**
+	 * Cuerpo de la corrutina. No es virtual pura para no depender de
+	 * __cxa_pure_virtual, de libsupc++, que no se enlaza
+	 */
+	virtual void run(){}
+
+	/**
+	 * Pila mínima: el marco de expulsión de la tarea, el de coro_swap y el
+	 * de una llamada
+	 */
+	static constexpr uint32_t min_stack = TASK_FRAME_WORDS * 4 + 9 * 4 + 32;
+
+	/**
+	 * Suspende la corrutina y vuelve al código que la reanudó
+	 */
+	void yield(){
+		state = state_suspended;
+		coro_swap(&sp, caller_sp);
+	}
+
+	/**
+	 * Suspende la corrutina durante un número de milisegundos
+	 * @param ms	Milisegundos
+	 */
+	void await_ms(uint32_t ms){
+		wake_tick = systimer_get_ticks() + SYSTIMER_MS_TO_TICKS(ms);
+		delayed = true;
+
+		while(sleeping(systimer_get_ticks())){
+			yield();
+		}
+
+		delayed = false;
+	}
+
+	/**
+	 * Suspende la corrutina hasta que llegue un byte por una uart
+	 * @param uart	Identificador de la uart
+	 * @return		El byte recibido
+	 */
+	uint8_t await_uart_byte(uart_id_t uart){
+		char c;
+
+		polling = true;
+
+		while(uart_receive(uart, &c, 1) != 1){
+			yield();
+		}
+
+		polling = false;
+
+		return (uint8_t) c;
+	}
+
+	/**
+	 * Suspende la corrutina hasta que se cumpla una condición
+	 * @param cond	Función u objeto sin parámetros que retorna bool
+	 */
+	template <class F>
+	void await(F cond){
+		polling = true;
+
+		while(!cond()){
+			yield();
+		}
+
+		polling = false;
+	}
+
+private:
+	friend class coroutine_scheduler;
+
+	/**
+	 * Prepara en la pila el marco inicial de coro_swap, que entra en
+	 * coro_entry con r4 = this y r5 = entry
+	 */
+	void start(){
+		uint32_t *top = (uint32_t *) (((uint32_t) stack + stack_size) & ~7);
+		uint32_t i;
+
+		*--top = (uint32_t) coro_entry;		/* lr */
+
+		for(i = 0; i < 6; i++){
+			*--top = 0;						/* r11-r6 */
+		}
+
+		*--top = (uint32_t) entry;			/* r5 */
+		*--top = (uint32_t) this;			/* r4 */
+		sp = (uint32_t) top;
+	}
+
+	/**
+	 * Función con la que empieza la corrutina. Al terminar run() vuelve al
+	 * código que la reanudó y ya no se vuelve a reanudar
+	 * @param self	La corrutina
+	 */
+	static void entry(coroutine_base *self){
+		self->run();
+		self->state = state_finished;
+		coro_swap(&self->sp, self->caller_sp);
+	}
+
+	coroutine_base *next;				/* Siguiente en coroutine_scheduler */
+	uint32_t sp;						/* sp guardado de la corrutina */
+	uint32_t caller_sp;					/* sp guardado del que la reanuda */
+	uint32_t *stack;					/* Pila */
+	uint32_t stack_size;				/* Tamaño de la pila en bytes */
+	volatile state_t state;				/* Estado */
+	bool delayed;						/* Espera a wake_tick */
+	bool polling;						/* Espera a una condición de E/S */
+	uint32_t wake_tick;					/* Tick al que se despierta */
+};
+
+/*****************************************************************************/
+
+/**
+ * Corrutina con una pila de Bytes bytes dentro del propio objeto, así que
+ * su coste en RAM se conoce al compilar
+ */
+template <uint32_t Bytes>
+class coroutine : public coroutine_base{
+protected:
+	constexpr coroutine() : coroutine_base(stack_area, sizeof(stack_area)),
+		stack_area() {}
+
+private:
+	/* Al menos el marco de expulsión, el de coro_swap y el de una llamada */
+	static_assert(Bytes >= coroutine_base::min_stack,
+			"La pila de una corrutina debe absorber el marco de expulsión de la tarea (TASK_FRAME_WORDS)");
+
+	uint32_t stack_area[(Bytes + 7) / 8 * 2] __attribute__ ((aligned (8)));
+};
+
+/*****************************************************************************/
+
+/**
+ * Planificador de corrutinas por turnos, que se ejecuta en una tarea
+ * En cada vuelta reanuda las corrutinas que no esperan a un tick. Cuando
+ * ninguna queda lista (todas esperan a un tick o a una condición de E/S), la
+ * tarea duerme hasta el primer tick pendiente, y las condiciones de E/S
+ * (await_uart_byte, await) se vuelven a comprobar en el siguiente tick
+ */
+class coroutine_scheduler{
+public:
+	constexpr coroutine_scheduler() : head(0) {}
+
+	/**
+	 * Añade una corrutina al planificador
+	 * @param coro	Corrutina, que aún no ha empezado
+	 */
+	void add(coroutine_base &coro){
+		coro.next = head;
+		head = &coro;
+	}
+
+	/**
+	 * Ejecuta las corrutinas hasta que terminan todas
+	 */
+	void run(){
+		coroutine_base *coro;
+		uint32_t now, wake;
+		bool alive, ready, poll, timed;
+
+		do{
+			alive = false;
+			ready = false;
+			poll = false;
+			timed = false;
+			wake = 0;
+			now = systimer_get_ticks();
+
+			for(coro = head; coro; coro = coro->next){
+				if(!coro->finished() && !coro->sleeping(now)){
+					coro->resume();
+				}
+
+				if(coro->finished()){
+					continue;
+				}
+
+				alive = true;
+
+				if(coro->delayed){
+					/* Tick de la espera más próxima */
+					if(!timed || (int32_t) (coro->wake_tick - wake) < 0){
+						wake = coro->wake_tick;
+						timed = true;
+					}
+				}
+				else if(coro->polling){
+					poll = true;
+				}
+				else{
+					ready = true;
+				}
+			}
+
+			if(alive && !ready){
+				if(poll && (!timed || (int32_t) (now + 1 - wake) < 0)){
+					wake = now + 1;
+				}
+
+				task_sleep_until(wake);
+			}
+		} while(alive);
+	}
+
+private:
+	coroutine_base *head;				/* Lista de corrutinas */
+};
+
+/*****************************************************************************/
+
+#endif /* __COROUTINE_H__ */
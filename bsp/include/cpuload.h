@@ -0,0 +1,79 @@
+/*
+ * Sistemas operativos empotrados
+ * Medida de la carga de la CPU
+ */
+
+#ifndef __CPULOAD_H__
+#define __CPULOAD_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Ventanas deslizantes sobre las que se mide la carga
+ * La de 100 ms y la de 1 s avanzan cada 100 ms; la de 10 s, cada segundo
+ */
+typedef enum{
+	cpuload_window_100ms = 0,
+	cpuload_window_1s,
+	cpuload_window_10s,
+	cpuload_window_max
+} cpuload_window_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa la medida de la carga. Arranca un temporizador software que
+ * toma una muestra cada 100 ms
+ */
+void cpuload_init ();
+
+/*****************************************************************************/
+
+/**
+ * Marca la entrada en la tarea ociosa. La llama task_pick_next al elegirla,
+ * con las IRQ deshabilitadas
+ */
+void cpuload_idle_enter ();
+
+/*****************************************************************************/
+
+/**
+ * Marca la salida de la tarea ociosa y acumula el tiempo que ha estado en
+ * ejecución. La llama task_pick_next al elegir otra tarea, con las IRQ
+ * deshabilitadas
+ */
+void cpuload_idle_exit ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna la carga de la CPU en una ventana: la parte del tiempo que no se
+ * ha pasado en la tarea ociosa. Incluye las tareas, las esperas activas como
+ * systimer_sleep_ms y las interrupciones que llegan durante ellas. Las que
+ * interrumpen a la tarea ociosa se cuentan como tiempo ocioso
+ * @param window	Ventana
+ * @return			Carga en tantos por mil
+ */
+uint32_t cpuload_get (cpuload_window_t window);
+
+/*****************************************************************************/
+
+/**
+ * Vacía las ventanas y, con ITC_STATS, las estadísticas del ITC, para medir
+ * el tiempo de cada fuente de interrupción desde este momento
+ */
+void cpuload_reset ();
+
+/*****************************************************************************/
+
+/**
+ * Imprime la carga en cada ventana y, con ITC_STATS, la parte del tiempo
+ * desde cpuload_reset que se ha pasado en cada fuente de interrupción
+ */
+void cpuload_print ();
+
+/*****************************************************************************/
+
+#endif /* __CPULOAD_H__ */
@@ -0,0 +1,97 @@
+/*
+ * Sistemas operativos empotrados
+ * Driver para el módulo de reloj y reset (CRM) del MC1322x
+ */
+
+#ifndef __CRM_H__
+#define __CRM_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Fases de un cambio de frecuencia
+ */
+typedef enum{
+	crm_clock_pre_change,		/* Antes del cambio, con la frecuencia anterior */
+	crm_clock_switch,			/* Justo antes de escribir el nuevo divisor */
+	crm_clock_post_change,		/* Después del cambio, con la nueva frecuencia */
+	crm_clock_abort				/* Cambio cancelado después de la fase previa */
+} crm_clock_event_t;
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para las funciones que se notifican de los cambios de frecuencia
+ * Se llaman en orden de registro. La fase previa se ejecuta con las
+ * interrupciones habilitadas, así que en ella se puede esperar (por ejemplo
+ * a que se vacíe una cola). En ella pueden rechazar el cambio, por lo que
+ * no deben hacer nada que no siga siendo válido con la frecuencia anterior
+ * Las fases crm_clock_switch y crm_clock_post_change se ejecutan con las
+ * interrupciones deshabilitadas, alrededor de la escritura del divisor, y
+ * deben ser breves: sólo reprogramar registros
+ * Si el cambio se cancela, los que ya pasaron la fase previa reciben
+ * crm_clock_abort para deshacer lo que hicieron en ella. Quien rechaza el
+ * cambio no lo recibe, así que debe rechazarlo antes de cambiar nada
+ * @param event		Fase del cambio
+ * @param old_freq	Frecuencia anterior
+ * @param new_freq	Frecuencia nueva
+ * @return			Distinto de cero en la fase previa para rechazar el cambio
+ */
+typedef int32_t (* crm_clock_notifier_t) (crm_clock_event_t event, uint32_t old_freq, uint32_t new_freq);
+
+/*****************************************************************************/
+
+/**
+ * Inicializa el driver. El sistema arranca a CPU_FREQ sin dividir
+ */
+void crm_init ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna la frecuencia actual del reloj del sistema, que es también la del
+ * bus de periféricos
+ * @return	Frecuencia en Hz
+ */
+uint32_t crm_get_freq ();
+
+/*****************************************************************************/
+
+/**
+ * Cambia el divisor del reloj del sistema. La frecuencia resultante es
+ * CRM_XTAL_FREQ / (div + 1)
+ * No se puede llamar desde los manejadores de interrupción ni desde una
+ * región crítica: los drivers pueden esperar en la fase previa
+ * @param div	Divisor, entre 0 y CRM_MAX_DIV
+ * @return		Cero en caso de éxito o -1 en caso de error (EBUSY si algún
+ * 				driver rechaza el cambio).
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t crm_set_divider (uint32_t div);
+
+/*****************************************************************************/
+
+/**
+ * Fija la mayor frecuencia del reloj del sistema que no supera la indicada
+ * No se puede llamar desde los manejadores de interrupción
+ * @param freq	Frecuencia máxima en Hz
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t crm_set_freq (uint32_t freq);
+
+/*****************************************************************************/
+
+/**
+ * Registra una función para que se le notifiquen los cambios de frecuencia
+ * @param notifier	Función
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t crm_register_notifier (crm_clock_notifier_t notifier);
+
+/*****************************************************************************/
+
+#endif /* __CRM_H__ */
@@ -0,0 +1,104 @@
+/*
+ * Sistemas operativos empotrados
+ * Bucle de eventos
+ */
+
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Opciones de un tipo de evento
+ */
+#define EVENT_COALESCE		(1 << 0)	/* Los envíos repetidos se funden en uno */
+
+/**
+ * Evento de tarea (task_post_event) con el que se despierta el bucle
+ */
+#define EVENT_TASK_EVENT	(1u << 31)
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para los manejadores de eventos
+ * @param type		Tipo del evento
+ * @param payload	Dato enviado con el evento
+ */
+typedef void (* event_handler_t) (uint32_t type, uint32_t payload);
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas del bucle de eventos
+ */
+typedef struct{
+	uint32_t posted;				/* Eventos encolados */
+	uint32_t coalesced;				/* Envíos fundidos con uno pendiente */
+	uint32_t dropped;				/* Envíos perdidos por la cola llena */
+	uint32_t dispatched;			/* Eventos atendidos */
+	uint32_t max_depth;				/* Máxima ocupación de la cola */
+} event_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa la cola de eventos y anula los manejadores
+ */
+void event_init ();
+
+/*****************************************************************************/
+
+/**
+ * Registra el manejador de un tipo de evento
+ * @param type		Tipo, menor que EVENT_MAX_TYPES
+ * @param handler	Manejador. NULL para anular uno anterior
+ * @param flags		Opciones (EVENT_COALESCE)
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t event_register (uint32_t type, event_handler_t handler, uint32_t flags);
+
+/*****************************************************************************/
+
+/**
+ * Envía un evento al bucle. Nunca bloquea, así que se puede llamar desde los
+ * manejadores de interrupción
+ * Si el tipo se registró con EVENT_COALESCE y ya tiene un evento pendiente,
+ * no se encola otro: el pendiente se atiende con el último payload
+ * @param type		Tipo del evento
+ * @param payload	Dato para el manejador
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t event_post (uint32_t type, uint32_t payload);
+
+/*****************************************************************************/
+
+/**
+ * Atiende los eventos pendientes, en orden de llegada, sin esperar
+ * @return	Número de eventos atendidos
+ */
+uint32_t event_dispatch ();
+
+/*****************************************************************************/
+
+/**
+ * Bucle de eventos. La tarea que lo llama atiende los eventos y, mientras
+ * la cola está vacía, duerme esperando EVENT_TASK_EVENT. No retorna
+ */
+void event_loop ();
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas del bucle de eventos
+ * @param stats		Estructura donde se copian las estadísticas
+ */
+void event_stats_get (event_stats_t *stats);
+
+/*****************************************************************************/
+
+#endif /* __EVENT_H__ */
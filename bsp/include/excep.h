@@ -34,6 +34,67 @@ typedef void (* excep_handler_t) (void);
 
 /*****************************************************************************/
 
+/**
+ * Marca que indica que el registro de fallo es válido
+ */
+#define EXCEP_FAULT_MAGIC		0xfa17c0de
+
+/**
+ * Número de palabras que se guardan de la cima de la pila de cada modo
+ */
+#define EXCEP_FAULT_STACK_WORDS	8
+
+/**
+ * Modos cuya pila se guarda en el registro de fallo (SYS/USER, SVC, IRQ y FIQ)
+ */
+#define EXCEP_FAULT_STACKS		4
+
+/*****************************************************************************/
+
+/**
+ * Cima de la pila de un modo en el momento del fallo
+ * Las palabras por encima del tope de la pila se guardan como 0
+ */
+typedef struct{
+	uint32_t mode;
+	uint32_t sp;
+	uint32_t words[EXCEP_FAULT_STACK_WORDS];
+} excep_fault_stack_t;
+
+/*****************************************************************************/
+
+/**
+ * Registro de fallo que rellenan los manejadores de undef, pabt y dabt
+ * El orden de los campos lo usa excep_asm.s
+ */
+typedef struct{
+	uint32_t magic;						/* EXCEP_FAULT_MAGIC si es válido */
+	uint32_t type;						/* excep_undef, excep_pabt o excep_dabt */
+	uint32_t pc;						/* Instrucción que provocó el fallo */
+	uint32_t cpsr;						/* cpsr del código que falló */
+	uint32_t r[13];						/* r0-r12 */
+	uint32_t sp;						/* sp del modo que falló */
+	uint32_t lr;						/* lr del modo que falló */
+	excep_fault_stack_t stacks[EXCEP_FAULT_STACKS];
+} excep_fault_t;
+
+/*****************************************************************************/
+
+/**
+ * Contexto interrumpido que apila excep_nonnested_irq_handler_asm
+ * pc es la dirección de retorno de la interrupción (lr_irq - 4)
+ */
+typedef struct{
+	uint32_t r0;
+	uint32_t r1;
+	uint32_t r2;
+	uint32_t r3;
+	uint32_t r12;
+	uint32_t pc;
+} excep_irq_frame_t;
+
+/*****************************************************************************/
+
 /**
  * Inicializa los manejadores de excepción
  */
@@ -44,7 +105,8 @@ void excep_init ();
 /**
  * Deshabilita todas las interrupciones
  * Esta función sólo funciona en modos privilegiados. Desde modo USER no se
- * permite alterar los bits I y F de los registros de control
+ * permite alterar los bits I y F de los registros de control (ver
+ * swi_disable_ints)
  * @return	El valor de los bits I y F antes de deshabilitar las interrupciones:
  * 			0: I=0, F=0	(IRQ habilitadas,    FIQ habilitadas)
  * 			1: I=0, F=1	(IRQ habilitadas,    FIQ deshabilitadas)
@@ -147,6 +209,8 @@ void excep_nonnested_irq_handler ();
 
 /**
  * Manejador en ensamblador para interrupciones normales no anidadas
+ * Salta directamente al manejador indicado por nivector, pasándole la fuente
+ * en r0 y el marco con el contexto interrumpido (excep_irq_frame_t) en r1
  */
 void excep_nonnested_irq_handler_asm ();
 
@@ -159,4 +223,57 @@ void excep_nested_irq_handler ();
 
 /*****************************************************************************/
 
+/**
+ * Ejecuta una función en modo SYS con las interrupciones habilitadas
+ * Sólo se puede llamar desde un manejador de IRQ, y permite que el resto de
+ * su trabajo sea interrumpido por otras IRQ
+ * @param func	Función a ejecutar
+ */
+void excep_nested_call (void (* func) (void));
+
+/*****************************************************************************/
+
+/**
+ * Manejadores en ensamblador para las excepciones undef, pabt y dabt
+ * Guardan el contexto del fallo en excep_fault_record y cuelgan el sistema
+ */
+void excep_undef_fault_handler ();
+void excep_pabt_fault_handler ();
+void excep_dabt_fault_handler ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna el fallo registrado antes del último reinicio
+ * @return	Un puntero al registro del fallo o NULL si no hubo ninguno
+ */
+const excep_fault_t * excep_get_last_fault ();
+
+/*****************************************************************************/
+
+/**
+ * Imprime un registro de fallo por la salida estándar, en el formato que
+ * interpreta tools/fault-decode
+ * @param fault	Registro del fallo
+ */
+void excep_print_fault (const excep_fault_t *fault);
+
+/*****************************************************************************/
+
+/**
+ * Manejador en ensamblador para interrupciones software (llamadas al sistema)
+ * Ver swi.h
+ */
+void excep_swi_handler ();
+
+/*****************************************************************************/
+
+/**
+ * Manejador en ensamblador para interrupciones rápidas
+ * Usa los registros banqueados r8-r12 del modo FIQ, precargados en crt0.s
+ */
+void excep_fiq_handler ();
+
+/*****************************************************************************/
+
 #endif /* __EXCEP_H__ */
@@ -0,0 +1,113 @@
+/*
+ * Sistemas operativos empotrados
+ * Heap del sistema con TLSF
+ */
+
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+#include <stdint.h>
+#include "tlsf.h"
+
+/*****************************************************************************/
+
+/**
+ * Con HEAP_DEBUG (bsp.mk), cada reserva guarda en 8 bytes extra el punto
+ * del programa que la hizo y se lleva la cuenta por punto de llamada, hasta
+ * HEAP_DEBUG_SITES puntos. Las de los demás se suman en una entrada sin
+ * dirección
+ */
+#ifndef HEAP_DEBUG_SITES
+#define HEAP_DEBUG_SITES	16
+#endif
+
+/*****************************************************************************/
+
+/**
+ * Estado de _sbrk (syscalls.c). Tras heap_init el límite queda en
+ * _heap_end: el uso real lo dan las estadísticas del heap
+ */
+typedef struct{
+	uint32_t start;					/* _heap_start */
+	uint32_t end;					/* _heap_end */
+	uint32_t brk;					/* Límite actual del área reservada */
+	uint32_t peak_brk;				/* Máximo del límite */
+	uint32_t failures;				/* Peticiones rechazadas con ENOMEM */
+} sbrk_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas del heap
+ */
+typedef struct{
+	uint32_t allocs;				/* Reservas servidas desde el arranque */
+	uint32_t frees;					/* Liberaciones */
+	uint32_t failures;				/* Reservas fallidas */
+	uint32_t blocks;				/* Bloques reservados y no liberados */
+	uint32_t bytes;					/* Bytes utilizables de esos bloques */
+	tlsf_stats_t tlsf;				/* Ocupación, pico y fragmentación */
+} heap_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Reservas pendientes de un punto de llamada (HEAP_DEBUG)
+ */
+typedef struct{
+	void *site;						/* Dirección de retorno de la llamada */
+	uint32_t blocks;				/* Bloques reservados y no liberados */
+	uint32_t bytes;					/* Bytes utilizables de esos bloques */
+} heap_site_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa el heap: obtiene con _sbrk toda la sección .heap de
+ * econotag.ld y la gestiona con TLSF. Desde ese momento malloc, free,
+ * realloc, calloc y sus variantes _r de newlib usan TLSF, en tiempo
+ * constante y dentro de una sección crítica del ITC, así que también se
+ * pueden llamar desde las tareas
+ */
+void heap_init ();
+
+/*****************************************************************************/
+
+/**
+ * Copia el estado de _sbrk
+ * @param stats	Donde se copia el estado
+ */
+void sbrk_stats_get (sbrk_stats_t *stats);
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas del heap
+ * @param stats	Donde se copian las estadísticas
+ */
+void heap_stats_get (heap_stats_t *stats);
+
+/*****************************************************************************/
+
+/**
+ * Copia las reservas pendientes de un punto de llamada. Sólo con HEAP_DEBUG
+ * @param index	Entrada, de 0 a HEAP_DEBUG_SITES. La última agrupa los
+ * 				puntos que no caben en la tabla
+ * @param site	Donde se copian las reservas
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t heap_site_get (uint32_t index, heap_site_t *site);
+
+/*****************************************************************************/
+
+/**
+ * Imprime el estado de _sbrk y las estadísticas del heap y, con
+ * HEAP_DEBUG, las reservas pendientes de cada punto de llamada, que
+ * sirven para encontrar fugas
+ */
+void heap_stats_print ();
+
+/*****************************************************************************/
+
+#endif /* __HEAP_H__ */
@@ -43,6 +43,9 @@ typedef enum{
 
 /**
  * Prototipo para los manejadores de interrupción
+ * Los despachadores en ensamblador pasan además la fuente atendida en r0 y,
+ * en las IRQ, el contexto interrumpido en r1. Los manejadores que no los
+ * necesitan pueden ignorarlos
  */
 typedef void (* itc_handler_t) (void);
 
@@ -61,6 +64,7 @@ void itc_init ();
 /**
  * Deshabilita el envío de peticiones de interrupción a la CPU
  * Permite implementar regiones críticas en modo USER
+ * Las llamadas se pueden anidar: sólo la más externa guarda intenable
  */
 void itc_disable_ints ();
 
@@ -69,11 +73,42 @@ void itc_disable_ints ();
 /**
  * Vuelve a habilitar el envío de peticiones de interrupción a la CPU
  * Permite implementar regiones críticas en modo USER
+ * Sólo la llamada que cierra la región más externa restaura intenable
  */
 void itc_restore_ints ();
 
 /*****************************************************************************/
 
+/**
+ * Entra en una región crítica enmascarando en el ITC todas las fuentes
+ * Permite implementar regiones críticas en modo USER
+ * @return	Token con las fuentes que estaban habilitadas, para itc_critical_exit
+ */
+uint32_t itc_critical_enter ();
+
+/*****************************************************************************/
+
+/**
+ * Entra en una región crítica enmascarando sólo algunas fuentes
+ * Las fuentes que no están en la máscara siguen pudiendo interrumpir
+ * @param mask	Máscara de fuentes a enmascarar (bit i para la fuente i)
+ * @return		Token con las fuentes de la máscara que estaban habilitadas,
+ * 				para itc_critical_exit
+ */
+uint32_t itc_critical_enter_mask (uint32_t mask);
+
+/*****************************************************************************/
+
+/**
+ * Sale de una región crítica
+ * Sólo vuelve a habilitar las fuentes que deshabilitó la entrada
+ * correspondiente, por lo que las regiones se pueden anidar
+ * @param token	Valor retornado por itc_critical_enter o itc_critical_enter_mask
+ */
+void itc_critical_exit (uint32_t token);
+
+/*****************************************************************************/
+
 /**
  * Asigna un manejador de interrupción
  * @param src		Identificador de la fuente
@@ -91,6 +126,18 @@ void itc_set_handler (itc_src_t src, itc_handler_t handler);
 void itc_set_priority (itc_src_t src, itc_priority_t priority);
 
 /*****************************************************************************/
+
+/**
+ * Registra el manejador de una fuente de interrupción rápida (FIQ).
+ * Asigna el manejador, marca la fuente como rápida y la habilita. El
+ * manejador se ejecuta desde excep_fiq_handler en modo FIQ
+ * @param src		Identificador de la fuente
+ * @param handler	Manejador
+ */
+void itc_set_fast_handler (itc_src_t src, itc_handler_t handler);
+
+/*****************************************************************************/
+
 /**
  * Habilita las interrupciones de una determinda fuente
  * @param src		Identificador de la fuente
@@ -137,4 +184,72 @@ void itc_service_fast_interrupt ();
 
 /*****************************************************************************/
 
+#ifdef ITC_STATS
+
+/**
+ * Número de intervalos del histograma de duraciones. El intervalo i cuenta
+ * las duraciones d con 2^i <= d < 2^(i+1) ticks (el 0 incluye d = 0)
+ */
+#define ITC_STATS_BINS	32
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas de una fuente de interrupción. Los tiempos se miden en ticks
+ * del reloj monotónico de los temporizadores (tmr_get_freq Hz)
+ * La latencia es el tiempo desde que la fuente se activa hasta que empieza
+ * su manejador. Sólo se mide en las interrupciones cuyo instante de
+ * activación se conoce: las forzadas con itc_force_interrupt y las que un
+ * driver anuncia con itc_stats_assert
+ */
+typedef struct{
+	uint32_t count;						/* Número de interrupciones servidas */
+	uint32_t min;						/* Duración mínima */
+	uint32_t max;						/* Duración máxima */
+	uint64_t total;						/* Suma de las duraciones */
+	uint32_t histogram[ITC_STATS_BINS];	/* Histograma log2 de las duraciones */
+	uint32_t latency_count;				/* Número de latencias medidas */
+	uint32_t latency_min;				/* Latencia mínima */
+	uint32_t latency_max;				/* Latencia máxima */
+	uint64_t latency_total;				/* Suma de las latencias */
+} itc_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Anuncia el instante en el que una fuente se activará o se ha activado,
+ * para medir la latencia de la siguiente interrupción que lo alcance
+ * @param src		Identificador de la fuente
+ * @param ticks		Instante de activación, en ticks de tmr_get_ticks
+ */
+void itc_stats_assert (itc_src_t src, uint64_t ticks);
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas acumuladas para una fuente de interrupción
+ * @param src		Identificador de la fuente
+ * @param stats		Estructura donde se copian las estadísticas
+ */
+void itc_stats_get (itc_src_t src, itc_stats_t *stats);
+
+/*****************************************************************************/
+
+/**
+ * Pone a cero las estadísticas de todas las fuentes
+ */
+void itc_stats_reset ();
+
+/*****************************************************************************/
+
+/**
+ * Imprime por la salida estándar las estadísticas de las fuentes que han
+ * generado alguna interrupción
+ */
+void itc_stats_print ();
+
+#endif /* ITC_STATS */
+
+/*****************************************************************************/
+
 #endif /* __ITC_H__ */
@@ -0,0 +1,123 @@
+/*
+ * Sistemas operativos empotrados
+ * Colas de mensajes sin copia entre tareas y manejadores de interrupción
+ */
+
+#ifndef __MSGQ_H__
+#define __MSGQ_H__
+
+#include <stdint.h>
+#include "task.h"
+
+/*****************************************************************************/
+
+/**
+ * Opciones de una cola de mensajes
+ */
+#define MSGQ_SPSC	(1 << 0)	/* Un solo productor y un solo consumidor */
+
+/*****************************************************************************/
+
+/**
+ * Cola de mensajes. Un mensaje es un puntero a un búfer, normalmente de un
+ * pool: la cola no copia datos, sólo transfiere la propiedad del búfer.
+ * Tras enviarlo, el emisor no debe volver a usarlo; el receptor pasa a ser
+ * su dueño y es quien lo libera o lo reenvía
+ */
+typedef struct{
+	void **slots;					/* Huecos para los mensajes */
+	uint32_t size;					/* Número de huecos, potencia de 2 */
+	volatile uint32_t head;			/* Índice libre de escritura */
+	volatile uint32_t tail;			/* Índice libre de lectura */
+	uint32_t flags;					/* Opciones */
+	task_wait_queue_t senders;		/* Tareas esperando un hueco */
+	task_wait_queue_t receivers;	/* Tareas esperando un mensaje */
+} msgq_t;
+
+/*****************************************************************************/
+
+/**
+ * Declara los huecos de una cola de mensajes
+ * @param name	Nombre de la variable
+ * @param size	Número de mensajes, potencia de 2
+ */
+#define MSGQ_SLOTS(name, size)	static void *name[size]
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una cola de mensajes
+ * Con MSGQ_SPSC, el envío y la recepción sin espera no usan secciones
+ * críticas. Sólo se puede indicar si los mensajes los envía una sola tarea
+ * o un solo manejador (que no se anida consigo mismo) y los recibe otro
+ * @param q		Cola
+ * @param slots	Huecos, declarados con MSGQ_SLOTS
+ * @param size	Número de huecos, potencia de 2
+ * @param flags	Opciones (MSGQ_SPSC)
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t msgq_init (msgq_t *q, void **slots, uint32_t size, uint32_t flags);
+
+/*****************************************************************************/
+
+/**
+ * Envía un mensaje, esperando a que haya hueco si la cola está llena
+ * @param q				Cola
+ * @param msg			Mensaje, cuya propiedad pasa al receptor
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EAGAIN sin espera, ETIMEDOUT si vence el plazo
+ */
+int32_t msgq_send (msgq_t *q, void *msg, uint32_t timeout_ms);
+
+/*****************************************************************************/
+
+/**
+ * Recibe un mensaje, esperando a que llegue si la cola está vacía
+ * @param q				Cola
+ * @param msg			Donde se guarda el mensaje, que pasa a ser del receptor
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EAGAIN sin espera, ETIMEDOUT si vence el plazo
+ */
+int32_t msgq_receive (msgq_t *q, void **msg, uint32_t timeout_ms);
+
+/*****************************************************************************/
+
+/**
+ * Envía un mensaje sin esperar. Se puede llamar desde los manejadores de
+ * interrupción: si despierta a una tarea más prioritaria, el cambio se hace
+ * al salir de la IRQ
+ * @param q		Cola
+ * @param msg	Mensaje, cuya propiedad pasa al receptor
+ * @return		Cero en caso de éxito o -1 si la cola está llena (EAGAIN)
+ */
+int32_t msgq_send_isr (msgq_t *q, void *msg);
+
+/*****************************************************************************/
+
+/**
+ * Recibe un mensaje sin esperar. Se puede llamar desde los manejadores de
+ * interrupción
+ * @param q		Cola
+ * @param msg	Donde se guarda el mensaje, que pasa a ser del receptor
+ * @return		Cero en caso de éxito o -1 si la cola está vacía (EAGAIN)
+ */
+int32_t msgq_receive_isr (msgq_t *q, void **msg);
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de mensajes en la cola
+ * @param q		Cola
+ */
+uint32_t msgq_count (msgq_t *q);
+
+/*****************************************************************************/
+
+#endif /* __MSGQ_H__ */
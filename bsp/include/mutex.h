@@ -0,0 +1,70 @@
+/*
+ * Sistemas operativos empotrados
+ * Mutex con herencia de prioridad
+ */
+
+#ifndef __MUTEX_H__
+#define __MUTEX_H__
+
+#include <stdint.h>
+#include "task.h"
+
+/*****************************************************************************/
+
+/**
+ * Mutex con herencia de prioridad. Mientras una tarea más prioritaria espera
+ * el mutex, su dueño se ejecuta con la prioridad de ella, también a través
+ * de una cadena de mutex, así que una tarea de prioridad intermedia no puede
+ * retrasar indefinidamente a la más prioritaria (inversión de prioridad)
+ * Al liberarlo se cede directamente a la tarea más prioritaria que espera
+ * No es recursivo y sólo se puede usar desde tareas
+ */
+typedef struct mutex{
+	task_t *owner;					/* Dueño o NULL si está libre */
+	struct mutex *next_held;		/* Siguiente mutex del mismo dueño */
+	task_wait_queue_t waiters;		/* Tareas esperando el mutex */
+} mutex_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializador estático de un mutex
+ */
+#define MUTEX_INITIALIZER	{ NULL, NULL, { NULL } }
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un mutex libre
+ * @param m	Mutex
+ */
+void mutex_init (mutex_t *m);
+
+/*****************************************************************************/
+
+/**
+ * Coge un mutex, esperando a que quede libre si lo tiene otra tarea
+ * Sin contención, sólo hace una sección crítica del ITC y una comparación
+ * @param m				Mutex
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EBUSY sin espera, ETIMEDOUT si vence el plazo,
+ * 						EDEADLK si la tarea ya es su dueña
+ */
+int32_t mutex_lock (mutex_t *m, uint32_t timeout_ms);
+
+/*****************************************************************************/
+
+/**
+ * Libera un mutex. Si hay tareas esperando, pasa a ser de la más prioritaria
+ * y el dueño vuelve a la prioridad que le dejen los mutex que aún tiene
+ * @param m	Mutex
+ * @return	Cero en caso de éxito o -1 si la tarea no es su dueña (EPERM)
+ */
+int32_t mutex_unlock (mutex_t *m);
+
+/*****************************************************************************/
+
+#endif /* __MUTEX_H__ */
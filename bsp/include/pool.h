@@ -0,0 +1,102 @@
+/*
+ * Sistemas operativos empotrados
+ * Pools de bloques de tamaño fijo, utilizables desde las interrupciones
+ */
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*****************************************************************************/
+
+/**
+ * Clases de tamaño de los pools: X(bytes, bloques) por clase, en orden
+ * creciente de tamaño y sin tamaños repetidos. Los tamaños se redondean a
+ * múltiplos de 8 para que los bloques queden alineados como exige el AAPCS
+ * Se puede cambiar desde bsp.mk, p.ej. '-DPOOL_CLASSES(X)=X(32, 16) X(128, 8)'
+ */
+#ifndef POOL_CLASSES
+#define POOL_CLASSES(X)	X(16, 32) X(64, 16) X(256, 8)
+#endif
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas de una clase de tamaño
+ */
+typedef struct{
+	uint32_t block_size;			/* Tamaño de los bloques en bytes */
+	uint32_t blocks;				/* Número de bloques */
+	uint32_t free;					/* Bloques libres */
+	uint32_t min_free;				/* Mínimo de bloques libres */
+	uint32_t allocs;				/* Reservas servidas por esta clase */
+	uint32_t failures;				/* Reservas que no encontraron bloques libres */
+} pool_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa los pools, dejando libres todos sus bloques
+ */
+void pool_init ();
+
+/*****************************************************************************/
+
+/**
+ * Reserva un bloque de la clase más pequeña en la que cabe size y que tenga
+ * bloques libres. Se puede llamar desde los manejadores de interrupción: el
+ * coste no depende de la ocupación, sólo del número de clases
+ * @param size	Tamaño en bytes
+ * @return		El bloque o NULL si no queda ninguno (ENOMEM) o
+ * 				ninguna clase es tan grande (EINVAL)
+ */
+void *pool_alloc (size_t size);
+
+/*****************************************************************************/
+
+/**
+ * Libera un bloque de pool_alloc. Se puede llamar desde los manejadores de
+ * interrupción
+ * @param block	Bloque
+ * @return		Cero en caso de éxito o -1 si el bloque no es de un pool
+ * 				(EINVAL)
+ */
+int32_t pool_free (void *block);
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de clases de tamaño
+ */
+uint32_t pool_classes ();
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas de una clase de tamaño
+ * @param index	Índice de la clase, en orden creciente de tamaño
+ * @param stats	Donde se copian las estadísticas
+ * @return		Cero en caso de éxito o -1 si la clase no existe (EINVAL)
+ */
+int32_t pool_stats_get (uint32_t index, pool_stats_t *stats);
+
+/*****************************************************************************/
+
+/**
+ * Pone a cero los contadores de reservas y el mínimo de bloques libres de
+ * todas las clases
+ */
+void pool_stats_reset ();
+
+/*****************************************************************************/
+
+/**
+ * Imprime las estadísticas de todas las clases
+ */
+void pool_stats_print ();
+
+/*****************************************************************************/
+
+#endif /* __POOL_H__ */
@@ -0,0 +1,74 @@
+/*
+ * Sistemas operativos empotrados
+ * Perfilador estadístico por muestreo del contador de programa
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Formato de los paquetes que se envían por PROFILER_UART_ID (little endian):
+ *	0xa5 0x5a			sincronización
+ *	n					número de muestras (1..PROFILER_BATCH)
+ *	perdidas			muestras perdidas desde el paquete anterior (satura en 255)
+ *	n x { pc[4], lr[4], psr }
+ *						pc interrumpido (lr_irq - 4), lr del banco de usuario si
+ *						el modo interrumpido es USR o SYS (0 si no) y bits 0-5
+ *						de spsr_irq
+ *	suma				suma de 8 bits de los bytes desde n hasta la última muestra
+ * tools/pc-profile interpreta el flujo y descarta lo que no son paquetes
+ * Si PROFILER_UART_ID es la consola, lo que escriben las tareas se intercala
+ * con los paquetes y los corta, así que por defecto se usa la otra UART
+ * Cada muestra ocupa 9 bytes, así que a 115200 baudios el muestreo no debe
+ * pasar de unos 1000 Hz
+ */
+#define PROFILER_SYNC0		0xa5
+#define PROFILER_SYNC1		0x5a
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas del perfilador
+ */
+typedef struct{
+	uint32_t samples;		/* Muestras tomadas */
+	uint32_t dropped;		/* Muestras perdidas por tener la cola llena */
+	uint32_t no_frame;		/* Interrupciones sin contexto interrumpido */
+	uint32_t packets;		/* Paquetes enviados */
+} profiler_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Arranca el perfilador. Cada muestra se toma en la interrupción del
+ * temporizador PROFILER_TMR_ID y se envía desde un softirq de prioridad baja
+ * Sólo se ven los modos interrumpibles por IRQ: los manejadores que se
+ * ejecutan en modo IRQ no aparecen, pero el trabajo diferido sí
+ * @param hz	Frecuencia de muestreo
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t profiler_start (uint32_t hz);
+
+/*****************************************************************************/
+
+/**
+ * Detiene el perfilador. Las muestras pendientes se descartan
+ */
+void profiler_stop ();
+
+/*****************************************************************************/
+
+/**
+ * Obtiene las estadísticas del perfilador
+ * @param stats	Estructura donde se almacenan
+ */
+void profiler_get_stats (profiler_stats_t *stats);
+
+/*****************************************************************************/
+
+#endif /* __PROFILER_H__ */
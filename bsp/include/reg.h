@@ -0,0 +1,160 @@
+/*
+ * Sistemas operativos empotrados
+ * Acceso a los registros de los periféricos
+ */
+
+#ifndef __REG_H__
+#define __REG_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Los registros se declaran como volatile uint32_t y sus campos como pares
+ * de macros <CAMPO>_SHIFT y <CAMPO>_MASK. Todos los accesos son de 32 bits
+ * y cada macro hace exactamente las lecturas y escrituras que indica, a
+ * diferencia de los campos de bits volatile, cuya asignación es siempre
+ * una lectura-modificación-escritura que además escribe lo leído en los
+ * bits que en lectura y en escritura significan cosas distintas
+ */
+
+/**
+ * Máscara de un campo
+ * @param shift	Posición del bit menos significativo
+ * @param width	Número de bits, menor que 32
+ */
+#define REG_MASK(shift, width)		((((uint32_t) 1 << (width)) - 1) << (shift))
+
+/**
+ * Máscara de un bit
+ * @param bit	Posición del bit
+ */
+#define REG_BIT(bit)				((uint32_t) 1 << (bit))
+
+/**
+ * Valor de un campo colocado en su posición, para combinarlo con otros
+ * mediante | en una sola escritura
+ * @param field	Prefijo de las macros _SHIFT y _MASK del campo
+ * @param value	Valor del campo
+ */
+#define REG_VAL(field, value)		(((uint32_t) (value) << field##_SHIFT) & field##_MASK)
+
+/**
+ * Extrae un campo de un valor ya leído de un registro
+ * @param field	Prefijo de las macros _SHIFT y _MASK del campo
+ * @param value	Valor del registro
+ */
+#define REG_FIELD(field, value)		(((uint32_t) (value) & field##_MASK) >> field##_SHIFT)
+
+/*****************************************************************************/
+
+/**
+ * Lectura y escritura de un registro completo
+ * @param reg	Registro (lvalue volatile uint32_t)
+ * @param value	Valor
+ */
+#define REG_READ(reg)				(*(volatile uint32_t *) &(reg))
+#define REG_WRITE(reg, value)		(*(volatile uint32_t *) &(reg) = (uint32_t) (value))
+
+/**
+ * Lectura de un campo: una lectura del registro
+ * @param reg	Registro
+ * @param field	Prefijo de las macros _SHIFT y _MASK del campo
+ */
+#define REG_GET(reg, field)			REG_FIELD(field, REG_READ(reg))
+
+/**
+ * Lectura-modificación-escritura: pone a cero los bits de clear y a uno los
+ * de set con una lectura y una escritura. Para cambiar varios campos a la
+ * vez, se combinan sus máscaras y sus REG_VAL
+ * @param reg	Registro
+ * @param clear	Máscara de bits a borrar
+ * @param set	Bits a poner a uno, dentro de clear o fuera
+ */
+#define REG_MODIFY(reg, clear, set)	\
+	REG_WRITE(reg, (REG_READ(reg) & ~(uint32_t) (clear)) | (uint32_t) (set))
+
+/**
+ * Escritura de un campo conservando el resto del registro
+ * @param reg	Registro
+ * @param field	Prefijo de las macros _SHIFT y _MASK del campo
+ * @param value	Valor del campo
+ */
+#define REG_SET(reg, field, value)	REG_MODIFY(reg, field##_MASK, REG_VAL(field, value))
+
+/**
+ * Puesta a uno y a cero de bits conservando el resto del registro
+ * @param reg	Registro
+ * @param mask	Bits
+ */
+#define REG_SET_BITS(reg, mask)		REG_MODIFY(reg, 0, mask)
+#define REG_CLEAR_BITS(reg, mask)	REG_MODIFY(reg, mask, 0)
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+
+/*
+ * Campos para C++: el desplazamiento y la anchura son parámetros de la
+ * plantilla y todo se calcula al compilar. Se declara como C++ aunque la
+ * cabecera se incluya dentro de un bloque extern "C"
+ */
+extern "C++" {
+
+/**
+ * Campo de Width bits a partir del bit Shift de un registro de 32 bits
+ * Ejemplo: typedef reg_field<0, 6> tx_fifo_free;
+ * 			if(tx_fifo_free::read(regs->TxCON)) ...
+ */
+template <unsigned Shift, unsigned Width>
+struct reg_field{
+	static_assert(Width > 0 && Shift + Width <= 32, "El campo no cabe en un registro de 32 bits");
+
+	static constexpr uint32_t shift = Shift;
+	static constexpr uint32_t mask = (Width == 32 ? ~(uint32_t) 0 : ((uint32_t) 1 << Width) - 1) << Shift;
+
+	/**
+	 * Valor del campo colocado en su posición, para combinarlo con otros
+	 */
+	static constexpr uint32_t value(uint32_t v){
+		return (v << Shift) & mask;
+	}
+
+	/**
+	 * Extrae el campo de un valor ya leído
+	 */
+	static constexpr uint32_t get(uint32_t reg){
+		return (reg & mask) >> Shift;
+	}
+
+	/**
+	 * Lee el campo con una lectura del registro
+	 */
+	static uint32_t read(const volatile uint32_t &reg){
+		return get(reg);
+	}
+
+	/**
+	 * Escribe el campo con una lectura y una escritura del registro
+	 */
+	static void write(volatile uint32_t &reg, uint32_t v){
+		reg = (reg & ~mask) | value(v);
+	}
+};
+
+/**
+ * Lectura-modificación-escritura de varios campos a la vez
+ * Ejemplo: reg_modify(regs->CON, a::mask | b::mask, a::value(1) | b::value(0))
+ */
+inline void reg_modify(volatile uint32_t &reg, uint32_t clear, uint32_t set){
+	reg = (reg & ~clear) | set;
+}
+
+}
+
+#endif /* __cplusplus */
+
+/*****************************************************************************/
+
+#endif /* __REG_H__ */
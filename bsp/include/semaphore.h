@@ -0,0 +1,90 @@
+/*
+ * Sistemas operativos empotrados
+ * Semáforos contadores
+ */
+
+#ifndef __SEMAPHORE_H__
+#define __SEMAPHORE_H__
+
+#include <stdint.h>
+#include "task.h"
+
+/*****************************************************************************/
+
+/**
+ * Semáforo contador. Las tareas lo cogen, esperando si la cuenta es cero, y
+ * tanto las tareas como los manejadores de interrupción lo dan. Al darlo
+ * con tareas esperando, la unidad pasa directamente a la más prioritaria
+ */
+typedef struct{
+	volatile uint32_t count;		/* Unidades disponibles */
+	uint32_t max;					/* Cuenta máxima */
+	task_wait_queue_t waiters;		/* Tareas esperando una unidad */
+} semaphore_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializador estático de un semáforo
+ * @param count	Cuenta inicial
+ * @param max	Cuenta máxima
+ */
+#define SEMAPHORE_INITIALIZER(count, max)	{ (count), (max), { NULL } }
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un semáforo
+ * @param s		Semáforo
+ * @param count	Cuenta inicial
+ * @param max	Cuenta máxima, 1 para un semáforo binario
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t semaphore_init (semaphore_t *s, uint32_t count, uint32_t max);
+
+/*****************************************************************************/
+
+/**
+ * Coge una unidad del semáforo, esperando si la cuenta es cero
+ * Si hay unidades, sólo hace una sección crítica del ITC y un decremento
+ * @param s				Semáforo
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EAGAIN sin espera, ETIMEDOUT si vence el plazo
+ */
+int32_t semaphore_take (semaphore_t *s, uint32_t timeout_ms);
+
+/*****************************************************************************/
+
+/**
+ * Da una unidad al semáforo, despertando a la tarea más prioritaria que
+ * espera. Se puede llamar desde los manejadores de interrupción: si la
+ * tarea despertada es más prioritaria, el cambio se hace al salir de la IRQ
+ * @param s	Semáforo
+ * @return	Cero en caso de éxito o -1 si la cuenta ya es la máxima (EOVERFLOW)
+ */
+int32_t semaphore_give (semaphore_t *s);
+
+/*****************************************************************************/
+
+/**
+ * Da una unidad al semáforo desde un manejador de interrupción
+ * @param s	Semáforo
+ * @return	Cero en caso de éxito o -1 si la cuenta ya es la máxima (EOVERFLOW)
+ */
+int32_t semaphore_give_isr (semaphore_t *s);
+
+/*****************************************************************************/
+
+/**
+ * Retorna las unidades disponibles de un semáforo
+ * @param s	Semáforo
+ */
+uint32_t semaphore_count (semaphore_t *s);
+
+/*****************************************************************************/
+
+#endif /* __SEMAPHORE_H__ */
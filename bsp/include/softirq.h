@@ -0,0 +1,55 @@
+/*
+ * Sistemas operativos empotrados
+ * Trabajo diferido de las interrupciones (softirq)
+ */
+
+#ifndef __SOFTIRQ_H__
+#define __SOFTIRQ_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Prioridades del trabajo diferido
+ */
+typedef enum{
+	softirq_priority_high = 0,
+	softirq_priority_normal,
+	softirq_priority_low,
+	softirq_priority_max
+} softirq_priority_t;
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para las funciones de trabajo diferido
+ */
+typedef void (* softirq_func_t) (void *arg);
+
+/*****************************************************************************/
+
+/**
+ * Inicializa las colas de trabajo diferido y registra el manejador de la
+ * fuente de interrupción SOFTIRQ_SRC, que se fuerza para ejecutarlo
+ */
+void softirq_init ();
+
+/*****************************************************************************/
+
+/**
+ * Encola trabajo diferido y fuerza la interrupción SOFTIRQ_SRC
+ * El trabajo se ejecuta en modo SYS con las IRQ habilitadas, en orden de
+ * prioridad y, dentro de la misma prioridad, en orden de llegada
+ * Se puede llamar desde los manejadores de interrupción
+ * @param priority	Prioridad del trabajo
+ * @param func		Función a ejecutar
+ * @param arg		Argumento para la función
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t softirq_post (softirq_priority_t priority, softirq_func_t func, void *arg);
+
+/*****************************************************************************/
+
+#endif /* __SOFTIRQ_H__ */
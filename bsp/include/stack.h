@@ -0,0 +1,114 @@
+/*
+ * Sistemas operativos empotrados
+ * Medida del uso máximo de las pilas
+ */
+
+#ifndef __STACK_H__
+#define __STACK_H__
+
+#include <stdint.h>
+#include "task.h"
+
+/*****************************************************************************/
+
+/**
+ * Valor con el que se pintan las pilas libres. Debe coincidir con
+ * _STACK_FILLER de crt0.s, que pinta las pilas de los modos al arrancar
+ */
+#define STACK_FILLER	0xdeadbeef
+
+/*****************************************************************************/
+
+/**
+ * Pilas de los modos del procesador, definidas en econotag.ld
+ * El modo USER usa la pila del modo SYSTEM. El trabajo diferido de las
+ * interrupciones (excep_nested_call) se ejecuta en modo SYSTEM en su propia
+ * pila
+ */
+typedef enum{
+	stack_mode_sys = 0,
+	stack_mode_softirq,
+	stack_mode_svc,
+	stack_mode_abt,
+	stack_mode_und,
+	stack_mode_irq,
+	stack_mode_fiq,
+	stack_mode_max
+} stack_mode_t;
+
+/*****************************************************************************/
+
+/**
+ * Uso de una pila en bytes
+ */
+typedef struct{
+	uint32_t size;					/* Tamaño */
+	uint32_t peak;					/* Uso máximo desde que se pintó */
+} stack_usage_t;
+
+/*****************************************************************************/
+
+/**
+ * Pinta una pila con STACK_FILLER. Sólo se debe llamar sobre pilas que no
+ * estén en uso
+ * @param bottom	Dirección más baja de la pila
+ * @param size		Tamaño en bytes
+ */
+void stack_paint (uint32_t *bottom, uint32_t size);
+
+/*****************************************************************************/
+
+/**
+ * Calcula el uso máximo de una pila pintada buscando, desde su dirección
+ * más baja, la primera palabra que ya no vale STACK_FILLER
+ * Una palabra que se escribió con STACK_FILLER se cuenta como libre
+ * @param bottom	Dirección más baja de la pila
+ * @param size		Tamaño en bytes
+ * @return			Bytes usados. Si es igual al tamaño, la pila ha
+ * 					llegado a su límite y probablemente se ha desbordado
+ */
+uint32_t stack_peak (const uint32_t *bottom, uint32_t size);
+
+/*****************************************************************************/
+
+/**
+ * Retorna el uso de la pila de un modo del procesador
+ * @param mode	Modo
+ * @param usage	Donde se copia el uso
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t stack_mode_usage (stack_mode_t mode, stack_usage_t *usage);
+
+/*****************************************************************************/
+
+/**
+ * Retorna el uso de la pila de una tarea. La tarea main no tiene pila
+ * propia: usa la del modo SYSTEM
+ * @param task	Tarea
+ * @param usage	Donde se copia el uso
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t stack_task_usage (task_t *task, stack_usage_t *usage);
+
+/*****************************************************************************/
+
+/**
+ * Cuenta las pilas, de los modos y de las tareas, que han llegado a su
+ * límite. Se puede llamar periódicamente para detectar un desbordamiento
+ * antes de que corrompa las variables o el heap que hay debajo
+ * @return	Número de pilas llenas
+ */
+uint32_t stack_check ();
+
+/*****************************************************************************/
+
+/**
+ * Imprime el tamaño y el uso máximo de la pila de cada modo y de cada tarea
+ */
+void stack_print ();
+
+/*****************************************************************************/
+
+#endif /* __STACK_H__ */
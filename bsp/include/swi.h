@@ -0,0 +1,113 @@
+/*
+ * Sistemas operativos empotrados
+ * Llamadas al sistema mediante interrupciones software (SWI)
+ */
+
+#ifndef __SWI_H__
+#define __SWI_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Números de las llamadas al sistema
+ * Las primeras se atienden directamente en excep_swi_handler sin pasar por la
+ * tabla de manejadores. El resto se pueden asignar con swi_set_handler
+ */
+typedef enum{
+	swi_num_disable_ints = 0,	/* Ruta rápida: deshabilita IRQ y FIQ */
+	swi_num_restore_ints,		/* Ruta rápida: restaura los bits I y F */
+	swi_num_yield,				/* Ruta rápida: cede el procesador */
+	swi_num_fast_max,			/* Primera llamada atendida por la tabla */
+	swi_num_max = 16
+} swi_num_t;
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para los manejadores de las llamadas al sistema
+ * Reciben los argumentos en r0-r3 y retornan el resultado en r0. Se ejecutan
+ * en modo SVC con las IRQ deshabilitadas
+ */
+typedef uint32_t (* swi_handler_t) (uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/*****************************************************************************/
+
+/**
+ * Realiza la llamada al sistema num con cuatro argumentos
+ * num debe ser una constante conocida en tiempo de compilación, ya que se
+ * codifica en la propia instrucción swi
+ * @return	El valor retornado por el manejador
+ */
+#define SWI_CALL(num, a0, a1, a2, a3) ({									\
+	register uint32_t __r0 asm("r0") = (uint32_t) (a0);					\
+	register uint32_t __r1 asm("r1") = (uint32_t) (a1);					\
+	register uint32_t __r2 asm("r2") = (uint32_t) (a2);					\
+	register uint32_t __r3 asm("r3") = (uint32_t) (a3);					\
+	asm volatile(															\
+		"swi %[n]"															\
+		:	"+r" (__r0), "+r" (__r1), "+r" (__r2), "+r" (__r3)				\
+		:	[n] "i" (num)													\
+		:	"r12", "lr", "cc", "memory"										\
+	);																		\
+	__r0;																	\
+})
+
+/*****************************************************************************/
+
+/**
+ * Inicializa la tabla de llamadas al sistema e instala excep_swi_handler
+ */
+void swi_init ();
+
+/*****************************************************************************/
+
+/**
+ * Asigna el manejador de una llamada al sistema
+ * @param num		Número de la llamada (desde swi_num_fast_max)
+ * @param handler	Manejador. NULL para anular una asignación anterior
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t swi_set_handler (uint32_t num, swi_handler_t handler);
+
+/*****************************************************************************/
+
+/**
+ * Asigna el manejador de la llamada swi_num_yield
+ * El manejador se ejecuta como manejador de la excepción SWI (modo SVC,
+ * lr_svc con la dirección de retorno y spsr_svc con el cpsr del llamador) y
+ * debe retornar con movs pc, lr. Sin manejador, swi_yield retorna sin más
+ * @param handler	Manejador. NULL para anular una asignación anterior
+ */
+void swi_set_yield_handler (void (* handler) (void));
+
+/*****************************************************************************/
+
+/**
+ * Deshabilita las IRQ y FIQ desde cualquier modo, incluido USER
+ * @return	El valor de los bits I y F antes de deshabilitar las interrupciones,
+ * 			con el mismo formato que excep_disable_ints
+ */
+uint32_t swi_disable_ints ();
+
+/*****************************************************************************/
+
+/**
+ * Restaura los bits I y F desde cualquier modo, incluido USER
+ * @param if_bits	Valores anteriores de las máscaras, con el mismo formato
+ * 					que excep_restore_ints
+ */
+void swi_restore_ints (uint32_t if_bits);
+
+/*****************************************************************************/
+
+/**
+ * Cede el procesador mediante la llamada swi_num_yield
+ */
+void swi_yield ();
+
+/*****************************************************************************/
+
+#endif /* __SWI_H__ */
@@ -10,14 +10,30 @@
 #include "dev.h"
 
 #include "itc.h"
+#include "crm.h"
 #include "gpio.h"
 #include "uart.h"
+#include "tmr.h"
+#include "swi.h"
+#include "softirq.h"
+#include "systimer.h"
+#include "profiler.h"
+#include "task.h"
+#include "event.h"
+#include "msgq.h"
+#include "mutex.h"
+#include "semaphore.h"
+#include "stack.h"
+#include "cpuload.h"
+#include "pool.h"
+#include "heap.h"
+#include "arena.h"
 
 /*
  * Configuración de la CPU
  */
 
-/* Frecuencia de la CPU por defecto (24 MHz) */
+/* Frecuencia de la CPU por defecto (24 MHz). La actual la da crm_get_freq */
 #define CPU_FREQ               24000000u
 
 /* Máximo número de dispositivos gestionables por el BSP */
@@ -58,6 +74,64 @@
  */
 #define ITC_BASE		((void *) 0x80020000)
 
+/*
+ * Configuración del CRM
+ */
+#define CRM_BASE			((void *) 0x80003000)
+#define CRM_XTAL_FREQ		(CPU_FREQ)			/* Oscilador de referencia */
+#define CRM_MAX_DIV			0x3f				/* Máximo valor de XTAL_CLKDIV */
+#define CRM_MAX_NOTIFIERS	4					/* Drivers notificables */
+
+/*
+ * Configuración de los temporizadores
+ */
+#define TMR_BASE		((void *) 0x80007000)
+#define TMR_CLOCK_ID	(tmr_0)					/* Contador libre del sistema */
+
+/*
+ * Configuración del trabajo diferido (softirq)
+ */
+#define SOFTIRQ_SRC			(itc_src_asm)		/* Fuente que se fuerza, no usada por el BSP */
+#define SOFTIRQ_QUEUE_SIZE	16					/* Trabajos pendientes por prioridad */
+
+/*
+ * Configuración de los temporizadores software
+ * El tamaño de la rueda se fija con TIMER_WHEEL_BITS y TIMER_WHEEL_LEVELS
+ */
+#define SYSTIMER_TICK_US	1000				/* Resolución de los temporizadores */
+
+/*
+ * Espera de bajo consumo hasta la siguiente interrupción. El ARM7TDMI no
+ * tiene WFI y los modos de bajo consumo del CRM detienen el reloj de los
+ * temporizadores, que no podrían despertarlo, así que la espera es activa
+ */
+#define BSP_IDLE_WAIT()
+
+/*
+ * Configuración del perfilador
+ */
+#define PROFILER_TMR_ID		(tmr_1)				/* Temporizador de muestreo */
+#define PROFILER_UART_ID	(UART2_ID)			/* UART de las muestras, distinta de la consola */
+#define PROFILER_RING_SIZE	64					/* Muestras en cola, potencia de 2 */
+#define PROFILER_BATCH		16					/* Muestras por paquete */
+
+/*
+ * Configuración del núcleo de tareas
+ */
+#define TASK_PRIORITY_MAIN		16				/* Prioridad de main, 0 es la más alta */
+#define TASK_SLICE_MS			10				/* Rodaja entre tareas de igual prioridad */
+
+/* La tarea ociosa es la que más interrupciones recibe, pero su pila sólo */
+/* guarda el marco de expulsión (68 bytes) y el de task_idle_loop: el trabajo */
+/* diferido tiene su propia pila. stack_print muestra su uso como "idle" */
+#define TASK_IDLE_STACK_SIZE	256				/* Pila de la tarea ociosa en bytes */
+
+/*
+ * Configuración del bucle de eventos
+ */
+#define EVENT_MAX_TYPES		32					/* Tipos de evento, como mucho 32 */
+#define EVENT_QUEUE_SIZE	32					/* Eventos en cola, potencia de 2 */
+
 /*
 	Definición de NULL
 */
@@ -0,0 +1,128 @@
+/*
+ * Sistemas operativos empotrados
+ * Temporizadores software del sistema
+ */
+
+#ifndef __SYSTIMER_H__
+#define __SYSTIMER_H__
+
+#include <stdint.h>
+#include "timer_wheel.h"
+
+/*****************************************************************************/
+
+/**
+ * Opciones de los temporizadores
+ */
+#define SYSTIMER_DEFERRED	(1 << 0)	/* La función se ejecuta como softirq, fuera de la IRQ */
+
+/*****************************************************************************/
+
+/**
+ * Convierte milisegundos a ticks de los temporizadores, redondeando hacia arriba
+ */
+#define SYSTIMER_MS_TO_TICKS(ms)	\
+	((uint32_t) (((uint64_t) (ms) * 1000 + SYSTIMER_TICK_US - 1) / SYSTIMER_TICK_US))
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para las funciones de los temporizadores
+ */
+typedef void (* systimer_callback_t) (void *arg);
+
+/*****************************************************************************/
+
+/**
+ * Temporizador del sistema. Lo reserva el usuario, así que el número de
+ * temporizadores sólo está limitado por la memoria de la aplicación
+ */
+typedef struct{
+	timer_wheel_timer_t timer;		/* Nodo de la rueda */
+	systimer_callback_t callback;	/* Función a llamar al vencer */
+	void *arg;						/* Argumento para la función */
+	uint32_t period;				/* Periodo en ticks, 0 si es de un disparo */
+	uint32_t flags;					/* Opciones SYSTIMER_* */
+} systimer_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa los temporizadores del sistema. No hay tick periódico: la
+ * alarma del temporizador hardware se programa para el siguiente vencimiento
+ */
+void systimer_init ();
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un temporizador
+ * @param timer		Temporizador
+ * @param callback	Función a llamar al vencer
+ * @param arg		Argumento para la función
+ * @param flags		Opciones SYSTIMER_*
+ */
+void systimer_setup (systimer_t *timer, systimer_callback_t callback, void *arg, uint32_t flags);
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador, o lo rearranca si ya estaba activo
+ * Se puede llamar desde los manejadores de interrupción y desde la propia
+ * función del temporizador
+ * @param timer		Temporizador
+ * @param ms		Milisegundos hasta el primer vencimiento
+ * @param period_ms	Periodo en milisegundos, 0 para un solo disparo
+ */
+void systimer_start (systimer_t *timer, uint32_t ms, uint32_t period_ms);
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador para que venza en un tick absoluto, o lo rearranca
+ * si ya estaba activo. Si el tick ya ha pasado, vence en cuanto se atienda
+ * la alarma
+ * @param timer		Temporizador
+ * @param tick		Tick de systimer_get_ticks
+ * @param period_ms	Periodo en milisegundos, 0 para un solo disparo
+ */
+void systimer_start_at (systimer_t *timer, uint32_t tick, uint32_t period_ms);
+
+/*****************************************************************************/
+
+/**
+ * Detiene un temporizador
+ * Una función diferida ya encolada se ejecuta aunque se detenga el temporizador
+ * @param timer		Temporizador
+ */
+void systimer_stop (systimer_t *timer);
+
+/*****************************************************************************/
+
+/**
+ * Retorna 1 si el temporizador está activo
+ * @param timer		Temporizador
+ */
+uint32_t systimer_is_active (systimer_t *timer);
+
+/*****************************************************************************/
+
+/**
+ * Duerme durante un número de milisegundos. Entre interrupciones el
+ * procesador queda en BSP_IDLE_WAIT y no hay tick periódico que lo despierte
+ * No se puede llamar desde los manejadores de interrupción
+ * @param ms	Milisegundos
+ */
+void systimer_sleep_ms (uint32_t ms);
+
+/*****************************************************************************/
+
+/**
+ * Retorna el tick actual de los temporizadores
+ * @return	Ticks de SYSTIMER_TICK_US microsegundos desde el arranque
+ */
+uint32_t systimer_get_ticks ();
+
+/*****************************************************************************/
+
+#endif /* __SYSTIMER_H__ */
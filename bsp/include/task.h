@@ -0,0 +1,317 @@
+/*
+ * Sistemas operativos empotrados
+ * Núcleo expropiativo de tareas con prioridades
+ */
+
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include <stdint.h>
+#include "systimer.h"
+
+/*****************************************************************************/
+
+/**
+ * Número de prioridades. 0 es la más alta. El tamaño lo fija el mapa de bits
+ * de la cola de preparadas, una palabra de 32 bits
+ */
+#define TASK_PRIORITIES	32
+
+/**
+ * Límite de una espera sin tiempo máximo (task_deadline, task_block)
+ */
+#define TASK_WAIT_FOREVER	0xffffffff
+
+/*****************************************************************************/
+
+/**
+ * Estados de una tarea
+ */
+typedef enum{
+	task_state_ready = 0,		/* En la cola de preparadas */
+	task_state_running,			/* En ejecución */
+	task_state_sleeping,		/* Esperando a su temporizador */
+	task_state_waiting,			/* Esperando eventos */
+	task_state_blocked,			/* Esperando en una cola de espera */
+	task_state_dead				/* Su función ha retornado */
+} task_state_t;
+
+/*****************************************************************************/
+
+/**
+ * Cola de tareas bloqueadas en un objeto del núcleo (cola de mensajes,
+ * mutex, semáforo), ordenada por prioridad y, a igual prioridad, por orden
+ * de llegada. Una cola a cero está vacía
+ */
+typedef struct{
+	struct task *head;
+} task_wait_queue_t;
+
+/**
+ * Mutex (mutex.h), para la herencia de prioridad
+ */
+struct mutex;
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para las funciones de las tareas
+ */
+typedef void (* task_func_t) (void *arg);
+
+/*****************************************************************************/
+
+/**
+ * Bloque de control de una tarea. Lo reserva el usuario, estáticamente,
+ * junto con su pila
+ * sp debe ser el primer campo: lo usa el cambio de contexto
+ */
+typedef struct task{
+	uint32_t sp;					/* Puntero de pila guardado */
+	struct task *next;				/* Siguiente en su cola de preparadas */
+	volatile task_state_t state;	/* Estado */
+	uint32_t priority;				/* Prioridad efectiva, 0 es la más alta */
+	uint32_t base_priority;			/* Prioridad sin herencia */
+	const char *name;				/* Nombre, para depuración */
+	uint32_t *stack;				/* Pila */
+	uint32_t stack_size;			/* Tamaño de la pila en bytes */
+	volatile uint32_t events;		/* Eventos recibidos y no consumidos */
+	uint32_t wait_mask;				/* Eventos que espera */
+	task_wait_queue_t *wait_queue;	/* Cola en la que está bloqueada */
+	struct task *wait_next;			/* Siguiente en esa cola */
+	volatile int32_t wait_result;	/* 0 si la despertaron, -1 si venció el plazo */
+	struct mutex *mutex_held;		/* Mutex que tiene cogidos */
+	struct mutex *mutex_wait;		/* Mutex por el que está bloqueada */
+	struct task *list_next;			/* Siguiente en la lista de todas */
+	systimer_t timer;				/* Temporizador para dormir y plazos */
+} task_t;
+
+/*****************************************************************************/
+
+/**
+ * Palabras del marco de task_switch_context: cpsr, r0-r12, sp, lr y pc
+ * Se guarda bajo sp_usr cada vez que se expulsa la tarea
+ */
+#define TASK_FRAME_WORDS	17
+
+/**
+ * Pila mínima de una tarea: el marco de expulsión y otro tanto para su
+ * propio código. Las IRQ, las FIQ, las SWI y el trabajo diferido
+ * (excep_nested_call) se ejecutan en las pilas de sus modos, no en la de
+ * la tarea interrumpida
+ */
+#define TASK_STACK_MIN		(2 * TASK_FRAME_WORDS * 4)
+
+/*****************************************************************************/
+
+/**
+ * Declara la pila de una tarea, alineada como exige el AAPCS
+ * @param name	Nombre de la variable
+ * @param bytes	Tamaño en bytes
+ */
+#define TASK_STACK(name, bytes)	\
+	static uint32_t name[((bytes) + 7) / 8 * 2] __attribute__ ((aligned (8)))
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas de los cambios de contexto. Las duraciones se miden en ticks
+ * del contador libre de los temporizadores, que avanza con el reloj del bus:
+ * un tick por ciclo de CPU
+ */
+typedef struct{
+	uint32_t switches;				/* Cambios a una tarea distinta */
+	uint32_t preemptions;			/* De ellos, expropiaciones */
+	uint32_t last_cycles;			/* Duración del último cambio */
+	uint32_t max_cycles;			/* Duración del peor caso */
+} task_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa el planificador. El código que lo llama (main) pasa a ser la
+ * primera tarea, con prioridad TASK_PRIORITY_MAIN y la pila del modo en el
+ * que se ejecuta, que debe ser el modo USER
+ */
+void task_init ();
+
+/*****************************************************************************/
+
+/**
+ * Crea una tarea y la deja preparada. Si tiene más prioridad que la tarea
+ * actual, la expropia en ese momento
+ * La tarea se ejecuta en modo USER con las interrupciones habilitadas
+ * @param task			Bloque de control
+ * @param name			Nombre
+ * @param func			Función de la tarea
+ * @param arg			Argumento para la función
+ * @param priority		Prioridad, menor que TASK_PRIORITIES. 0 es la más alta
+ * @param stack			Pila, declarada con TASK_STACK
+ * @param stack_size	Tamaño de la pila en bytes, al menos TASK_STACK_MIN
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global errno
+ */
+int32_t task_create (task_t *task, const char *name, task_func_t func, void *arg,
+		uint32_t priority, uint32_t *stack, uint32_t stack_size);
+
+/*****************************************************************************/
+
+/**
+ * Retorna la tarea en ejecución
+ */
+task_t *task_self ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna la primera tarea de la lista de todas las creadas, incluidas main
+ * y la tarea ociosa. Las demás se recorren con list_next
+ */
+task_t *task_list ();
+
+/*****************************************************************************/
+
+/**
+ * Indica si el código que llama se ejecuta en el nivel de tarea (modo USER)
+ * y no en un manejador de interrupción o de excepción
+ */
+uint32_t task_in_thread ();
+
+/*****************************************************************************/
+
+/**
+ * Cede el procesador a la siguiente tarea preparada de su misma prioridad
+ * Si no hay ninguna, la tarea sigue ejecutándose
+ */
+void task_yield ();
+
+/*****************************************************************************/
+
+/**
+ * Termina la tarea en ejecución. Se llama automáticamente cuando la función
+ * de la tarea retorna
+ */
+void task_exit ();
+
+/*****************************************************************************/
+
+/**
+ * Duerme la tarea hasta un tick de los temporizadores del sistema
+ * Para actividades periódicas sin deriva, se suma el periodo al tick
+ * anterior en lugar de al actual
+ * @param tick	Tick de systimer_get_ticks
+ */
+void task_sleep_until (uint32_t tick);
+
+/*****************************************************************************/
+
+/**
+ * Duerme la tarea durante un número de milisegundos
+ * @param ms	Milisegundos
+ */
+void task_sleep_ms (uint32_t ms);
+
+/*****************************************************************************/
+
+/**
+ * Espera a que la tarea reciba alguno de los eventos indicados
+ * @param mask	Eventos que se esperan
+ * @return		Los eventos de mask recibidos, que se consumen
+ */
+uint32_t task_wait_event (uint32_t mask);
+
+/*****************************************************************************/
+
+/**
+ * Envía eventos a una tarea, despertándola si los esperaba
+ * Se puede llamar desde los manejadores de interrupción: si la tarea
+ * despertada tiene más prioridad, el cambio se hace al salir de la IRQ
+ * @param task		Tarea
+ * @param events	Eventos
+ */
+void task_post_event (task_t *task, uint32_t events);
+
+/*****************************************************************************/
+
+/**
+ * Cierra una sección crítica de itc_critical_enter y, si en ella se ha
+ * preparado una tarea más prioritaria y se está en el nivel de tarea, le
+ * cede el procesador. En un manejador de interrupción el cambio se hace al
+ * salir de la IRQ. Los objetos del núcleo la usan tras task_wake_one
+ * @param token	Token de la sección crítica
+ */
+void task_critical_exit (uint32_t token);
+
+/*****************************************************************************/
+
+/**
+ * Calcula el tick límite de una espera
+ * @param timeout_ms	Plazo en milisegundos o TASK_WAIT_FOREVER
+ * @return				Tick límite para task_block o TASK_WAIT_FOREVER
+ */
+uint32_t task_deadline (uint32_t timeout_ms);
+
+/*****************************************************************************/
+
+/**
+ * Bloquea la tarea actual en una cola de espera hasta que la despierte
+ * task_wake_one o venza el plazo. No se puede llamar desde un manejador
+ * de interrupción
+ * @param queue		Cola de espera
+ * @param token		Token de la sección crítica en la que se comprobó que
+ * 					había que esperar, que se cierra
+ * @param deadline	Tick límite de task_deadline o TASK_WAIT_FOREVER
+ * @return			Cero si la despertaron o -1 si venció el plazo.
+ * 					En ese caso errno vale ETIMEDOUT
+ */
+int32_t task_block (task_wait_queue_t *queue, uint32_t token, uint32_t deadline);
+
+/*****************************************************************************/
+
+/**
+ * Despierta la tarea más prioritaria de una cola de espera
+ * Se debe llamar dentro de una sección crítica, también desde los
+ * manejadores de interrupción
+ * @param queue		Cola de espera
+ * @return			La tarea despertada o NULL si la cola estaba vacía
+ */
+task_t *task_wake_one (task_wait_queue_t *queue);
+
+/*****************************************************************************/
+
+/**
+ * Cambia la prioridad efectiva de una tarea, recolocándola en su cola de
+ * preparadas o de espera. Si la tarea actual deja de ser la más prioritaria,
+ * se pide un cambio de contexto. La usa la herencia de prioridad de los
+ * mutex; base_priority no cambia
+ * Se debe llamar dentro de una sección crítica
+ * @param task		Tarea
+ * @param priority	Prioridad, como mucho TASK_PRIORITIES - 1
+ */
+void task_set_priority (task_t *task, uint32_t priority);
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas de los cambios de contexto
+ * @param stats		Estructura donde se copian las estadísticas
+ */
+void task_stats_get (task_stats_t *stats);
+
+/*****************************************************************************/
+
+/**
+ * Pone a cero las estadísticas de los cambios de contexto
+ */
+void task_stats_reset ();
+
+/*****************************************************************************/
+
+/**
+ * Imprime por la salida estándar las estadísticas de los cambios de contexto
+ */
+void task_stats_print ();
+
+/*****************************************************************************/
+
+#endif /* __TASK_H__ */
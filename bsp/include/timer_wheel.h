@@ -0,0 +1,138 @@
+/*
+ * Sistemas operativos empotrados
+ * Rueda jerárquica de temporizadores software
+ */
+
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/**
+ * Configuración de la rueda: TIMER_WHEEL_LEVELS niveles de 2^TIMER_WHEEL_BITS
+ * ranuras. El nivel l agrupa los vencimientos en ranuras de 2^(BITS*l) ticks,
+ * así que la rueda cubre 2^(BITS*LEVELS) ticks. Los temporizadores más
+ * lejanos se guardan en la última ranura y se recolocan al llegar a ella.
+ * Ocupa LEVELS * 2^BITS punteros
+ */
+#ifndef TIMER_WHEEL_BITS
+#define TIMER_WHEEL_BITS	6
+#endif
+
+#ifndef TIMER_WHEEL_LEVELS
+#define TIMER_WHEEL_LEVELS	4
+#endif
+
+#define TIMER_WHEEL_SLOTS	(1 << TIMER_WHEEL_BITS)
+
+#if TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS >= 32
+#error "La rueda de temporizadores debe cubrir menos de 2^32 ticks"
+#endif
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para las funciones que se llaman al vencer un temporizador
+ */
+typedef void (* timer_wheel_callback_t) (void *arg);
+
+/*****************************************************************************/
+
+/**
+ * Temporizador. Lo reserva el usuario, la rueda sólo lo enlaza en sus listas
+ */
+typedef struct timer_wheel_timer{
+	struct timer_wheel_timer *next;		/* Siguiente en la ranura */
+	struct timer_wheel_timer **pprev;	/* Enlace que apunta a este temporizador, NULL si no está activo */
+	uint32_t expires;					/* Tick de vencimiento */
+	timer_wheel_callback_t callback;	/* Función a llamar al vencer */
+	void *arg;							/* Argumento para la función */
+} timer_wheel_timer_t;
+
+/*****************************************************************************/
+
+/**
+ * Estructura para gestionar una rueda de temporizadores
+ */
+typedef struct{
+	uint32_t now;										/* Siguiente tick a procesar */
+	uint32_t count;										/* Temporizadores activos */
+	timer_wheel_timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una rueda de temporizadores
+ * @param wheel	Rueda
+ * @param now	Tick actual
+ */
+void timer_wheel_init (timer_wheel_t *wheel, uint32_t now);
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un temporizador
+ * @param timer		Temporizador
+ * @param callback	Función a llamar al vencer
+ * @param arg		Argumento para la función
+ */
+void timer_wheel_timer_init (timer_wheel_timer_t *timer, timer_wheel_callback_t callback, void *arg);
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador, o cambia su vencimiento si ya estaba activo. O(1)
+ * @param wheel		Rueda
+ * @param timer		Temporizador
+ * @param expires	Tick de vencimiento. Si ya ha pasado, vence en el
+ * 					siguiente tick procesado
+ */
+void timer_wheel_add (timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint32_t expires);
+
+/*****************************************************************************/
+
+/**
+ * Detiene un temporizador. No hace nada si no estaba activo. O(1)
+ * @param wheel		Rueda
+ * @param timer		Temporizador
+ */
+void timer_wheel_remove (timer_wheel_t *wheel, timer_wheel_timer_t *timer);
+
+/*****************************************************************************/
+
+/**
+ * Retorna 1 si el temporizador está activo
+ * @param timer		Temporizador
+ */
+uint32_t timer_wheel_is_pending (timer_wheel_timer_t *timer);
+
+/*****************************************************************************/
+
+/**
+ * Calcula el primer tick en el que la rueda tiene trabajo: el vencimiento
+ * más próximo del nivel 0 o la recolocación de la primera ranura ocupada de
+ * los niveles superiores, lo que antes ocurra. Sirve para programar una
+ * alarma en lugar de un tick periódico
+ * @param wheel		Rueda
+ * @param next		Donde se almacena el tick
+ * @return			0 si no hay temporizadores activos
+ */
+uint32_t timer_wheel_next_expiry (timer_wheel_t *wheel, uint32_t *next);
+
+/*****************************************************************************/
+
+/**
+ * Procesa todos los ticks hasta now, incluido, llamando a las funciones de
+ * los temporizadores vencidos. El coste por tick es O(1) amortizado y los
+ * ticks sin trabajo se saltan
+ * @param wheel	Rueda
+ * @param now	Tick actual
+ */
+void timer_wheel_advance (timer_wheel_t *wheel, uint32_t now);
+
+/*****************************************************************************/
+
+#endif /* __TIMER_WHEEL_H__ */
@@ -0,0 +1,138 @@
+/*
+ * Sistemas operativos empotrados
+ * Gestor de memoria dinámica TLSF (two-level segregated fit)
+ */
+
+#ifndef __TLSF_H__
+#define __TLSF_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*****************************************************************************/
+
+/**
+ * Configuración de las listas de bloques libres
+ * El primer nivel separa los tamaños por potencias de 2 y el segundo divide
+ * cada potencia en 2^TLSF_SL_LOG2 listas. Los bloques menores que
+ * TLSF_SMALL_BLOCK van a listas de 8 en 8 bytes. Se pueden gestionar bloques
+ * de hasta 2^TLSF_FL_MAX bytes
+ */
+#define TLSF_ALIGN_LOG2		3
+#define TLSF_SL_LOG2		4
+#define TLSF_FL_MAX			17
+
+#define TLSF_ALIGN			(1 << TLSF_ALIGN_LOG2)
+#define TLSF_SL_COUNT		(1 << TLSF_SL_LOG2)
+#define TLSF_FL_SHIFT		(TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_COUNT		(TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_SMALL_BLOCK	(1 << TLSF_FL_SHIFT)
+
+/*****************************************************************************/
+
+/**
+ * Cabecera de un bloque. La carga útil empieza tras prev_phys y size, así
+ * que cada bloque reservado ocupa 8 bytes más de lo pedido. Los bloques
+ * libres guardan en su carga útil los enlaces de su lista
+ */
+typedef struct tlsf_block{
+	struct tlsf_block *prev_phys;	/* Bloque anterior en memoria, si está libre */
+	uint32_t size;					/* Tamaño de la carga útil y bits de estado */
+	struct tlsf_block *next_free;	/* Siguiente en su lista de libres */
+	struct tlsf_block *prev_free;	/* Anterior en su lista de libres */
+} tlsf_block_t;
+
+/*****************************************************************************/
+
+/**
+ * Estructura para gestionar una zona de memoria con TLSF
+ */
+typedef struct{
+	uint32_t fl_bitmap;								/* Listas de primer nivel no vacías */
+	uint32_t sl_bitmap[TLSF_FL_COUNT];				/* Listas de segundo nivel no vacías */
+	tlsf_block_t *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];	/* Listas de bloques libres */
+	uint32_t size;									/* Bytes gestionados */
+	uint32_t free;									/* Bytes libres */
+	uint32_t peak;									/* Máximo de bytes ocupados */
+} tlsf_t;
+
+/*****************************************************************************/
+
+/**
+ * Estadísticas de una zona. Los bytes ocupados incluyen las cabeceras
+ */
+typedef struct{
+	uint32_t size;					/* Bytes gestionados */
+	uint32_t used;					/* Bytes ocupados */
+	uint32_t peak;					/* Máximo de bytes ocupados */
+	uint32_t free;					/* Bytes libres */
+	uint32_t largest_free;			/* Mayor petición que tlsf_malloc puede servir */
+	uint32_t fragmentation;			/* 1000 - 1000 * largest_free / free */
+} tlsf_stats_t;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una zona de memoria como un único bloque libre
+ * @param tlsf	Estructura de gestión
+ * @param mem	Zona de memoria
+ * @param bytes	Tamaño de la zona
+ * @return		Cero en caso de éxito o -1 si la zona es demasiado pequeña o
+ * 				demasiado grande (EINVAL)
+ */
+int32_t tlsf_init (tlsf_t *tlsf, void *mem, size_t bytes);
+
+/*****************************************************************************/
+
+/**
+ * Reserva un bloque en tiempo constante
+ * @param tlsf	Estructura de gestión
+ * @param size	Tamaño en bytes
+ * @return		Puntero alineado a 8 bytes o NULL si no hay un bloque libre
+ * 				suficientemente grande
+ */
+void *tlsf_malloc (tlsf_t *tlsf, size_t size);
+
+/*****************************************************************************/
+
+/**
+ * Libera un bloque en tiempo constante, fusionándolo con sus vecinos libres
+ * @param tlsf	Estructura de gestión
+ * @param ptr	Bloque de tlsf_malloc o NULL
+ */
+void tlsf_free (tlsf_t *tlsf, void *ptr);
+
+/*****************************************************************************/
+
+/**
+ * Cambia el tamaño de un bloque sin moverlo, en tiempo constante. Para
+ * crecer absorbe el bloque siguiente si está libre
+ * @param tlsf	Estructura de gestión
+ * @param ptr	Bloque de tlsf_malloc
+ * @param size	Nuevo tamaño en bytes
+ * @return		ptr o NULL si no se puede cambiar sin moverlo
+ */
+void *tlsf_resize (tlsf_t *tlsf, void *ptr, size_t size);
+
+/*****************************************************************************/
+
+/**
+ * Retorna los bytes utilizables de un bloque, que pueden ser más de los
+ * pedidos
+ * @param ptr	Bloque de tlsf_malloc
+ */
+size_t tlsf_usable_size (void *ptr);
+
+/*****************************************************************************/
+
+/**
+ * Calcula las estadísticas de una zona. Para hallar el mayor bloque libre
+ * recorre la lista de libres más alta
+ * @param tlsf	Estructura de gestión
+ * @param stats	Donde se copian las estadísticas
+ */
+void tlsf_stats_get (tlsf_t *tlsf, tlsf_stats_t *stats);
+
+/*****************************************************************************/
+
+#endif /* __TLSF_H__ */
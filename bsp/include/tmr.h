@@ -0,0 +1,180 @@
+/*
+ * Sistemas operativos empotrados
+ * Driver para los temporizadores del MC1322x
+ */
+
+#ifndef __TMR_H__
+#define __TMR_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "excep.h"
+
+/*****************************************************************************/
+
+/**
+ * Temporizadores del sistema
+ */
+typedef enum{
+	tmr_0,
+	tmr_1,
+	tmr_2,
+	tmr_3,
+	tmr_max
+} tmr_id_t;
+
+/*****************************************************************************/
+
+/**
+ * Prototipo para las funciones de alarma
+ */
+typedef void (* tmr_callback_t) (void);
+
+/**
+ * Prototipo para los manejadores de los temporizadores periódicos
+ * frame es el contexto interrumpido, o NULL si el despachador de
+ * interrupciones no lo proporciona
+ */
+typedef void (* tmr_handler_t) (excep_irq_frame_t *frame);
+
+/*****************************************************************************/
+
+/**
+ * Relojes POSIX soportados por clock_gettime. newlib sólo los define en las
+ * plataformas con _POSIX_TIMERS
+ */
+#ifndef CLOCK_REALTIME
+#define CLOCK_REALTIME		((clockid_t) 1)
+#endif
+
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC		((clockid_t) 4)
+#endif
+
+/*****************************************************************************/
+
+/**
+ * Inicializa los temporizadores.
+ * El temporizador TMR_CLOCK_ID queda contando libremente a la frecuencia del
+ * bus de periféricos. Su interrupción de desbordamiento extiende la cuenta
+ * a 64 bits
+ */
+void tmr_init ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna el valor actual del contador libre
+ * El contador es de 16 bits, por lo que sólo sirve para medir intervalos
+ * cortos mediante la diferencia módulo 2^16 de dos lecturas
+ * @return	El valor del contador
+ */
+uint32_t tmr_get_count ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de ticks transcurridos desde el arranque
+ * Se puede llamar desde cualquier contexto, incluso con las interrupciones
+ * deshabilitadas durante menos de un desbordamiento (2^16 ticks)
+ * @return	Ticks del reloj monotónico de 64 bits
+ */
+uint64_t tmr_get_ticks ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna la frecuencia actual de los ticks, la del bus de periféricos
+ * @return	Ticks por segundo
+ */
+uint32_t tmr_get_freq ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de nanosegundos transcurridos desde el arranque
+ * Es continuo a través de los cambios de frecuencia del bus
+ * @return	Nanosegundos del reloj monotónico
+ */
+uint64_t tmr_get_ns ();
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de microsegundos transcurridos desde el arranque
+ * @return	Microsegundos del reloj monotónico
+ */
+uint64_t tmr_get_us ();
+
+/*****************************************************************************/
+
+/**
+ * Convierte microsegundos a ticks
+ * @param us	Microsegundos
+ * @return		Ticks equivalentes
+ */
+uint64_t tmr_us_to_ticks (uint64_t us);
+
+/*****************************************************************************/
+
+/**
+ * Espera activa de un número de microsegundos
+ * @param us	Microsegundos
+ */
+void tmr_delay_us (uint32_t us);
+
+/*****************************************************************************/
+
+/**
+ * Programa una alarma. Sólo hay una alarma, así que sustituye a la anterior
+ * La función se llama desde el manejador de interrupción de los
+ * temporizadores, aunque la alarma ya haya vencido al programarla
+ * @param ticks		Instante de vencimiento, en ticks del reloj monotónico
+ * @param callback	Función a llamar al vencer
+ */
+void tmr_set_alarm (uint64_t ticks, tmr_callback_t callback);
+
+/*****************************************************************************/
+
+/**
+ * Cancela la alarma programada
+ */
+void tmr_cancel_alarm ();
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador periódico
+ * Se busca el menor divisor del reloj del bus con el que el periodo cabe en
+ * el comparador de 16 bits
+ * @param id		Temporizador. No puede ser TMR_CLOCK_ID
+ * @param hz		Frecuencia de las interrupciones
+ * @param handler	Manejador, que se llama desde la interrupción
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t tmr_start_periodic (tmr_id_t id, uint32_t hz, tmr_handler_t handler);
+
+/*****************************************************************************/
+
+/**
+ * Detiene un temporizador periódico
+ * @param id		Temporizador
+ */
+void tmr_stop_periodic (tmr_id_t id);
+
+/*****************************************************************************/
+
+/**
+ * Obtiene la hora de un reloj POSIX. Ambos relojes cuentan desde el arranque
+ * @param clock_id	CLOCK_REALTIME o CLOCK_MONOTONIC
+ * @param tp		Estructura donde se almacena la hora
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int clock_gettime (clockid_t clock_id, struct timespec *tp);
+
+/*****************************************************************************/
+
+#endif /* __TMR_H__ */
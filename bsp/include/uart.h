@@ -65,6 +65,9 @@ uint8_t uart_receive_byte (uart_id_t uart);
 /**
  * Transmisión de bytes
  * Implementación del driver de nivel 1. La llamada es no bloqueante y se realiza mediante interrupciones
+ * Se puede llamar desde las tareas, desde el trabajo diferido y desde las
+ * callbacks de la propia uart. Los manejadores de otras fuentes deben
+ * diferir el envío, porque su interrupción no se enmascara durante la copia
  * @param uart	Identificador de la uart
  * @param buf	Búfer con los caracteres
  * @param count	Número de caracteres a escribir
@@ -0,0 +1,245 @@
+/*
+ * Sistemas operativos empotrados
+ * Medida de la carga de la CPU
+ */
+
+#include <string.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Periodo de muestreo y número de muestras de cada ventana
+ */
+#define CPULOAD_SAMPLE_MS	100
+#define CPULOAD_SAMPLES		10
+
+/**
+ * Ciclos totales y ociosos de un intervalo
+ */
+typedef struct{
+	uint32_t total;
+	uint32_t idle;
+} cpuload_sample_t;
+
+/**
+ * Ticks acumulados en la tarea ociosa e instante en el que entró en ella,
+ * o cero si no se está ejecutando
+ */
+static volatile uint64_t cpuload_idle_ticks;
+static volatile uint64_t cpuload_idle_since;
+
+/**
+ * Muestras de 100 ms y de 1 s, en anillo, y las que llevan
+ */
+static cpuload_sample_t cpuload_100ms[CPULOAD_SAMPLES];
+static cpuload_sample_t cpuload_1s[CPULOAD_SAMPLES];
+static uint32_t cpuload_100ms_count;
+static uint32_t cpuload_1s_count;
+
+/**
+ * Instante y ciclos ociosos de la última muestra, e instante de
+ * cpuload_reset
+ */
+static uint64_t cpuload_last_ticks;
+static uint64_t cpuload_last_idle;
+static uint64_t cpuload_reset_ticks;
+
+static systimer_t cpuload_timer;
+
+/*****************************************************************************/
+
+/**
+ * Suma las muestras de un anillo
+ * @param ring	Anillo
+ * @param count	Muestras que lleva
+ * @param sum	Donde se guarda la suma
+ */
+static void cpuload_sum(const cpuload_sample_t *ring, uint32_t count, cpuload_sample_t *sum){
+	uint32_t i;
+
+	sum->total = 0;
+	sum->idle = 0;
+
+	for(i = 0; i < count && i < CPULOAD_SAMPLES; i++){
+		sum->total += ring[i].total;
+		sum->idle += ring[i].idle;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Ticks ociosos hasta un instante, incluido el intervalo en curso si la
+ * tarea ociosa está en ejecución. Se llama con las IRQ deshabilitadas o
+ * desde una interrupción
+ * @param now	Instante, en ticks de tmr_get_ticks
+ * @return		Ticks ociosos acumulados
+ */
+static uint64_t cpuload_idle_total(uint64_t now){
+	uint64_t since = cpuload_idle_since;
+
+	return cpuload_idle_ticks + (since && since < now ? now - since : 0);
+}
+
+/*****************************************************************************/
+
+/**
+ * Toma una muestra cada CPULOAD_SAMPLE_MS y, cada CPULOAD_SAMPLES muestras,
+ * añade su suma a la ventana de 10 s
+ * @param arg	No se usa
+ */
+static void cpuload_sample(void *arg){
+	uint64_t now = tmr_get_ticks();
+	uint64_t idle = cpuload_idle_total(now);
+	cpuload_sample_t *sample = &cpuload_100ms[cpuload_100ms_count % CPULOAD_SAMPLES];
+
+	sample->total = (uint32_t) (now - cpuload_last_ticks);
+	sample->idle = (uint32_t) (idle - cpuload_last_idle);
+
+	/* El muestreo se retrasa con las interrupciones, nunca se adelanta */
+	if(sample->idle > sample->total){
+		sample->idle = sample->total;
+	}
+
+	cpuload_last_ticks = now;
+	cpuload_last_idle = idle;
+
+	if(++cpuload_100ms_count % CPULOAD_SAMPLES == 0){
+		cpuload_sum(cpuload_100ms, CPULOAD_SAMPLES,
+				&cpuload_1s[cpuload_1s_count++ % CPULOAD_SAMPLES]);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa la medida de la carga. Arranca un temporizador software que
+ * toma una muestra cada 100 ms
+ */
+void cpuload_init(){
+	cpuload_reset();
+
+	systimer_setup(&cpuload_timer, cpuload_sample, NULL, 0);
+	systimer_start(&cpuload_timer, CPULOAD_SAMPLE_MS, CPULOAD_SAMPLE_MS);
+}
+
+/*****************************************************************************/
+
+/**
+ * Marca la entrada en la tarea ociosa. La llama task_pick_next al elegirla,
+ * con las IRQ deshabilitadas
+ */
+void cpuload_idle_enter(){
+	cpuload_idle_since = tmr_get_ticks();
+}
+
+/*****************************************************************************/
+
+/**
+ * Marca la salida de la tarea ociosa y acumula el tiempo que ha estado en
+ * ejecución. La llama task_pick_next al elegir otra tarea, con las IRQ
+ * deshabilitadas
+ */
+void cpuload_idle_exit(){
+	uint64_t now = tmr_get_ticks();
+
+	cpuload_idle_ticks = cpuload_idle_total(now);
+	cpuload_idle_since = 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna la carga de la CPU en una ventana: la parte del tiempo que no se
+ * ha pasado en la tarea ociosa. Incluye las tareas, las esperas activas como
+ * systimer_sleep_ms y las interrupciones que llegan durante ellas. Las que
+ * interrumpen a la tarea ociosa se cuentan como tiempo ocioso
+ * @param window	Ventana
+ * @return			Carga en tantos por mil
+ */
+uint32_t cpuload_get(cpuload_window_t window){
+	cpuload_sample_t sum;
+	uint32_t token;
+
+	/* El muestreo no debe cambiar los anillos durante la suma */
+	token = itc_critical_enter();
+
+	switch(window){
+	case cpuload_window_100ms:
+		sum.total = 0;
+		sum.idle = 0;
+
+		if(cpuload_100ms_count){
+			sum = cpuload_100ms[(cpuload_100ms_count - 1) % CPULOAD_SAMPLES];
+		}
+		break;
+	case cpuload_window_1s:
+		cpuload_sum(cpuload_100ms, cpuload_100ms_count, &sum);
+		break;
+	default:
+		cpuload_sum(cpuload_1s, cpuload_1s_count, &sum);
+		break;
+	}
+
+	itc_critical_exit(token);
+
+	if(sum.total == 0){
+		return 0;
+	}
+
+	return (uint32_t) ((uint64_t) (sum.total - sum.idle) * 1000 / sum.total);
+}
+
+/*****************************************************************************/
+
+/**
+ * Vacía las ventanas y, con ITC_STATS, las estadísticas del ITC, para medir
+ * el tiempo de cada fuente de interrupción desde este momento
+ */
+void cpuload_reset(){
+	uint32_t token = itc_critical_enter();
+
+	cpuload_100ms_count = 0;
+	cpuload_1s_count = 0;
+	cpuload_last_ticks = tmr_get_ticks();
+	cpuload_last_idle = cpuload_idle_total(cpuload_last_ticks);
+	cpuload_reset_ticks = cpuload_last_ticks;
+
+#ifdef ITC_STATS
+	itc_stats_reset();
+#endif
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime la carga en cada ventana y, con ITC_STATS, la parte del tiempo
+ * desde cpuload_reset que se ha pasado en cada fuente de interrupción
+ */
+void cpuload_print(){
+	iprintf("load 100ms %lu 1s %lu 10s %lu (per mille)\r\n",
+			cpuload_get(cpuload_window_100ms), cpuload_get(cpuload_window_1s),
+			cpuload_get(cpuload_window_10s));
+
+#ifdef ITC_STATS
+	{
+		uint64_t elapsed = tmr_get_ticks() - cpuload_reset_ticks;
+		itc_stats_t stats;
+		uint32_t src;
+
+		for(src = 0; src < itc_src_max && elapsed; src++){
+			itc_stats_get(src, &stats);
+
+			if(stats.count){
+				iprintf("src %2lu %6lu per million\r\n", src,
+						(uint32_t) (stats.total * 1000000 / elapsed));
+			}
+		}
+	}
+#endif
+}
+
+/*****************************************************************************/
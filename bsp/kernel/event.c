@@ -0,0 +1,257 @@
+/*
+ * Sistemas operativos empotrados
+ * Bucle de eventos
+ */
+
+#include <string.h>
+#include <errno.h>
+#include "system.h"
+
+#if EVENT_MAX_TYPES > 32
+#error "EVENT_MAX_TYPES no puede ser mayor que 32 (event_pending es de 32 bits)"
+#endif
+
+#if EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)
+#error "EVENT_QUEUE_SIZE debe ser una potencia de 2"
+#endif
+
+/*****************************************************************************/
+
+/**
+ * Evento encolado
+ */
+typedef struct{
+	uint32_t type;
+	uint32_t payload;
+} event_t;
+
+/*****************************************************************************/
+
+/**
+ * Cola de eventos de un productor y un consumidor, con índices libres que
+ * sólo avanzan. Los productores (manejadores de interrupción, que pueden
+ * anidarse, y tareas) se serializan con una sección crítica de unas pocas
+ * instrucciones y nunca esperan; el consumidor, el bucle, no usa ninguna
+ */
+static event_t event_ring[EVENT_QUEUE_SIZE];
+static volatile uint32_t event_head;
+static volatile uint32_t event_tail;
+
+/**
+ * Manejadores y opciones de cada tipo
+ */
+static event_handler_t event_handlers[EVENT_MAX_TYPES];
+static uint32_t event_flags[EVENT_MAX_TYPES];
+
+/**
+ * Tipos con EVENT_COALESCE que tienen un evento en la cola, y el último
+ * payload enviado para cada uno
+ */
+static volatile uint32_t event_pending;
+static volatile uint32_t event_payload[EVENT_MAX_TYPES];
+
+/**
+ * Tarea que ejecuta event_loop, a la que se despierta al llegar un evento
+ * con la cola vacía
+ */
+static task_t *event_task;
+
+/**
+ * Estadísticas
+ */
+static volatile event_stats_t event_stats;
+
+/*****************************************************************************/
+
+/**
+ * Inicializa la cola de eventos y anula los manejadores
+ */
+void event_init(){
+	event_head = 0;
+	event_tail = 0;
+	event_pending = 0;
+	event_task = NULL;
+
+	memset(event_handlers, 0, sizeof(event_handlers));
+	memset(event_flags, 0, sizeof(event_flags));
+	memset((void *) &event_stats, 0, sizeof(event_stats));
+}
+
+/*****************************************************************************/
+
+/**
+ * Registra el manejador de un tipo de evento
+ * @param type		Tipo, menor que EVENT_MAX_TYPES
+ * @param handler	Manejador. NULL para anular uno anterior
+ * @param flags		Opciones (EVENT_COALESCE)
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t event_register(uint32_t type, event_handler_t handler, uint32_t flags){
+	uint32_t token;
+
+	if(type >= EVENT_MAX_TYPES){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	token = itc_critical_enter();
+
+	event_handlers[type] = handler;
+	event_flags[type] = flags;
+
+	itc_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Envía un evento al bucle. Nunca bloquea, así que se puede llamar desde los
+ * manejadores de interrupción
+ * Si el tipo se registró con EVENT_COALESCE y ya tiene un evento pendiente,
+ * no se encola otro: el pendiente se atiende con el último payload
+ * @param type		Tipo del evento
+ * @param payload	Dato para el manejador
+ * @return			Cero en caso de éxito o -1 en caso de error.
+ * 					La condición de error se indica en la variable global errno
+ */
+int32_t event_post(uint32_t type, uint32_t payload){
+	uint32_t token, head, depth;
+	uint32_t coalesce;
+
+	if(type >= EVENT_MAX_TYPES){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	coalesce = event_flags[type] & EVENT_COALESCE;
+	token = itc_critical_enter();
+
+	if(coalesce && (event_pending & (1 << type))){
+		event_payload[type] = payload;
+		event_stats.coalesced++;
+
+		itc_critical_exit(token);
+
+		return 0;
+	}
+
+	head = event_head;
+	depth = head - event_tail;
+
+	if(depth >= EVENT_QUEUE_SIZE){
+		event_stats.dropped++;
+
+		itc_critical_exit(token);
+
+		errno = EAGAIN;
+
+		return -1;
+	}
+
+	if(coalesce){
+		event_pending |= 1 << type;
+		event_payload[type] = payload;
+	}
+
+	event_ring[head & (EVENT_QUEUE_SIZE - 1)].type = type;
+	event_ring[head & (EVENT_QUEUE_SIZE - 1)].payload = payload;
+	event_head = head + 1;
+
+	event_stats.posted++;
+
+	if(depth + 1 > event_stats.max_depth){
+		event_stats.max_depth = depth + 1;
+	}
+
+	itc_critical_exit(token);
+
+	/* Sólo hace falta despertar al bucle cuando la cola estaba vacía */
+	if(depth == 0 && event_task){
+		task_post_event(event_task, EVENT_TASK_EVENT);
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Atiende los eventos pendientes, en orden de llegada, sin esperar
+ * @return	Número de eventos atendidos
+ */
+uint32_t event_dispatch(){
+	event_handler_t handler;
+	uint32_t tail = event_tail;
+	uint32_t type, payload, token;
+	uint32_t count = 0;
+
+	while(tail != event_head){
+		type = event_ring[tail & (EVENT_QUEUE_SIZE - 1)].type;
+		payload = event_ring[tail & (EVENT_QUEUE_SIZE - 1)].payload;
+
+		/* Un evento fundido lleva el último payload. Desde aquí, un nuevo */
+		/* envío del mismo tipo vuelve a encolarse */
+		if(event_flags[type] & EVENT_COALESCE){
+			token = itc_critical_enter();
+
+			payload = event_payload[type];
+			event_pending &= ~(1 << type);
+
+			itc_critical_exit(token);
+		}
+
+		/* Se libera la entrada antes de llamar al manejador */
+		event_tail = ++tail;
+
+		handler = event_handlers[type];
+
+		if(handler){
+			handler(type, payload);
+		}
+
+		count++;
+	}
+
+	event_stats.dispatched += count;
+
+	return count;
+}
+
+/*****************************************************************************/
+
+/**
+ * Bucle de eventos. La tarea que lo llama atiende los eventos y, mientras
+ * la cola está vacía, duerme esperando EVENT_TASK_EVENT. No retorna
+ */
+void event_loop(){
+	event_task = task_self();
+
+	while(1){
+		/* El evento de tarea queda anotado si llega entre la comprobación */
+		/* de la cola y la espera, así que no se pierde ningún aviso */
+		if(event_dispatch() == 0){
+			task_wait_event(EVENT_TASK_EVENT);
+		}
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas del bucle de eventos
+ * @param stats		Estructura donde se copian las estadísticas
+ */
+void event_stats_get(event_stats_t *stats){
+	uint32_t token = itc_critical_enter();
+
+	memcpy(stats, (void *) &event_stats, sizeof(event_stats_t));
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
@@ -0,0 +1,256 @@
+/*
+ * Sistemas operativos empotrados
+ * Colas de mensajes sin copia entre tareas y manejadores de interrupción
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Barrera del compilador: el mensaje se escribe en su hueco antes de
+ * publicar el índice, y las colas de espera se leen después. El ARM7TDMI
+ * no reordena los accesos a memoria
+ */
+#define msgq_barrier()	asm volatile("" : : : "memory")
+
+/*****************************************************************************/
+
+/**
+ * Escribe un mensaje en la cola si hay hueco. Sólo la llama un productor a
+ * la vez: el único con MSGQ_SPSC o el que está en la sección crítica
+ * @param q		Cola
+ * @param msg	Mensaje
+ * @return		1 si se ha escrito o 0 si la cola está llena
+ */
+static inline uint32_t msgq_push(msgq_t *q, void *msg){
+	uint32_t head = q->head;
+
+	if(head - q->tail >= q->size){
+		return 0;
+	}
+
+	q->slots[head & (q->size - 1)] = msg;
+	msgq_barrier();
+	q->head = head + 1;
+
+	return 1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Lee un mensaje de la cola si no está vacía. Sólo la llama un consumidor
+ * a la vez: el único con MSGQ_SPSC o el que está en la sección crítica
+ * @param q		Cola
+ * @param msg	Donde se guarda el mensaje
+ * @return		1 si se ha leído o 0 si la cola está vacía
+ */
+static inline uint32_t msgq_pop(msgq_t *q, void **msg){
+	uint32_t tail = q->tail;
+
+	if(tail == q->head){
+		return 0;
+	}
+
+	*msg = q->slots[tail & (q->size - 1)];
+	msgq_barrier();
+	q->tail = tail + 1;
+
+	return 1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Despierta a una tarea de una cola de espera tras mover un mensaje fuera
+ * de una sección crítica (ruta MSGQ_SPSC). Mirar la cola sin sección
+ * crítica es seguro: una tarea sólo se bloquea tras comprobar, dentro de
+ * una, que la cola de mensajes sigue llena o vacía, y mientras tanto ni el
+ * otro extremo ni una interrupción pueden ejecutarse
+ * @param queue	Cola de espera
+ */
+static void msgq_wake(task_wait_queue_t *queue){
+	uint32_t token;
+
+	msgq_barrier();
+
+	if(queue->head){
+		token = itc_critical_enter();
+		task_wake_one(queue);
+		task_critical_exit(token);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una cola de mensajes
+ * Con MSGQ_SPSC, el envío y la recepción sin espera no usan secciones
+ * críticas. Sólo se puede indicar si los mensajes los envía una sola tarea
+ * o un solo manejador (que no se anida consigo mismo) y los recibe otro
+ * @param q		Cola
+ * @param slots	Huecos, declarados con MSGQ_SLOTS
+ * @param size	Número de huecos, potencia de 2
+ * @param flags	Opciones (MSGQ_SPSC)
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t msgq_init(msgq_t *q, void **slots, uint32_t size, uint32_t flags){
+	if(q == NULL || slots == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	if(size == 0 || (size & (size - 1))){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	q->slots = slots;
+	q->size = size;
+	q->head = 0;
+	q->tail = 0;
+	q->flags = flags;
+	q->senders.head = NULL;
+	q->receivers.head = NULL;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Envía un mensaje, esperando a que haya hueco si la cola está llena
+ * @param q				Cola
+ * @param msg			Mensaje, cuya propiedad pasa al receptor
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EAGAIN sin espera, ETIMEDOUT si vence el plazo
+ */
+int32_t msgq_send(msgq_t *q, void *msg, uint32_t timeout_ms){
+	uint32_t token, deadline;
+
+	/* Ruta rápida con un solo productor: sin sección crítica */
+	if((q->flags & MSGQ_SPSC) && msgq_push(q, msg)){
+		msgq_wake(&q->receivers);
+
+		return 0;
+	}
+
+	deadline = timeout_ms ? task_deadline(timeout_ms) : 0;
+	token = itc_critical_enter();
+
+	while(!msgq_push(q, msg)){
+		if(timeout_ms == 0){
+			itc_critical_exit(token);
+
+			errno = EAGAIN;
+
+			return -1;
+		}
+
+		if(task_block(&q->senders, token, deadline)){
+			return -1;
+		}
+
+		token = itc_critical_enter();
+	}
+
+	task_wake_one(&q->receivers);
+	task_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Recibe un mensaje, esperando a que llegue si la cola está vacía
+ * @param q				Cola
+ * @param msg			Donde se guarda el mensaje, que pasa a ser del receptor
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EAGAIN sin espera, ETIMEDOUT si vence el plazo
+ */
+int32_t msgq_receive(msgq_t *q, void **msg, uint32_t timeout_ms){
+	uint32_t token, deadline;
+
+	/* Ruta rápida con un solo consumidor: sin sección crítica */
+	if((q->flags & MSGQ_SPSC) && msgq_pop(q, msg)){
+		msgq_wake(&q->senders);
+
+		return 0;
+	}
+
+	deadline = timeout_ms ? task_deadline(timeout_ms) : 0;
+	token = itc_critical_enter();
+
+	while(!msgq_pop(q, msg)){
+		if(timeout_ms == 0){
+			itc_critical_exit(token);
+
+			errno = EAGAIN;
+
+			return -1;
+		}
+
+		if(task_block(&q->receivers, token, deadline)){
+			return -1;
+		}
+
+		token = itc_critical_enter();
+	}
+
+	task_wake_one(&q->senders);
+	task_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Envía un mensaje sin esperar. Se puede llamar desde los manejadores de
+ * interrupción: si despierta a una tarea más prioritaria, el cambio se hace
+ * al salir de la IRQ
+ * @param q		Cola
+ * @param msg	Mensaje, cuya propiedad pasa al receptor
+ * @return		Cero en caso de éxito o -1 si la cola está llena (EAGAIN)
+ */
+inline int32_t msgq_send_isr(msgq_t *q, void *msg){
+	/* Sin plazo, msgq_send nunca llega a bloquearse */
+	return msgq_send(q, msg, 0);
+}
+
+/*****************************************************************************/
+
+/**
+ * Recibe un mensaje sin esperar. Se puede llamar desde los manejadores de
+ * interrupción
+ * @param q		Cola
+ * @param msg	Donde se guarda el mensaje, que pasa a ser del receptor
+ * @return		Cero en caso de éxito o -1 si la cola está vacía (EAGAIN)
+ */
+inline int32_t msgq_receive_isr(msgq_t *q, void **msg){
+	return msgq_receive(q, msg, 0);
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de mensajes en la cola
+ * @param q		Cola
+ */
+inline uint32_t msgq_count(msgq_t *q){
+	return q->head - q->tail;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,211 @@
+/*
+ * Sistemas operativos empotrados
+ * Mutex con herencia de prioridad
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Calcula la prioridad de una tarea: la suya o la de la tarea más
+ * prioritaria que espera alguno de sus mutex. Las colas de espera están
+ * ordenadas por prioridad, así que basta con mirar la primera de cada una
+ * Se debe llamar dentro de una sección crítica
+ * @param task	Tarea
+ * @return		Prioridad efectiva
+ */
+static uint32_t mutex_inherited_priority(task_t *task){
+	uint32_t priority = task->base_priority;
+	mutex_t *m;
+
+	for(m = task->mutex_held; m; m = m->next_held){
+		if(m->waiters.head && m->waiters.head->priority < priority){
+			priority = m->waiters.head->priority;
+		}
+	}
+
+	return priority;
+}
+
+/*****************************************************************************/
+
+/**
+ * Recalcula la prioridad heredada de una tarea y la propaga por la cadena
+ * de dueños de los mutex por los que está bloqueada
+ * Se debe llamar dentro de una sección crítica
+ * @param task	Tarea
+ */
+static void mutex_update_chain(task_t *task){
+	uint32_t priority;
+
+	while(task){
+		priority = mutex_inherited_priority(task);
+
+		if(priority == task->priority){
+			break;
+		}
+
+		task_set_priority(task, priority);
+		task = task->mutex_wait ? task->mutex_wait->owner : NULL;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Apunta un mutex como cogido por una tarea
+ * Se debe llamar dentro de una sección crítica
+ * @param m		Mutex
+ * @param task	Nuevo dueño
+ */
+static inline void mutex_take(mutex_t *m, task_t *task){
+	m->owner = task;
+	m->next_held = task->mutex_held;
+	task->mutex_held = m;
+}
+
+/*****************************************************************************/
+
+/**
+ * Quita un mutex de la lista de su dueño. Los mutex se suelen liberar en
+ * orden inverso, así que normalmente es el primero
+ * Se debe llamar dentro de una sección crítica
+ * @param m	Mutex
+ */
+static inline void mutex_release(mutex_t *m){
+	mutex_t **link = &m->owner->mutex_held;
+
+	while(*link != m){
+		link = &(*link)->next_held;
+	}
+
+	*link = m->next_held;
+	m->owner = NULL;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un mutex libre
+ * @param m	Mutex
+ */
+void mutex_init(mutex_t *m){
+	m->owner = NULL;
+	m->next_held = NULL;
+	m->waiters.head = NULL;
+}
+
+/*****************************************************************************/
+
+/**
+ * Coge un mutex, esperando a que quede libre si lo tiene otra tarea
+ * Sin contención, sólo hace una sección crítica del ITC y una comparación
+ * @param m				Mutex
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EBUSY sin espera, ETIMEDOUT si vence el plazo,
+ * 						EDEADLK si la tarea ya es su dueña
+ */
+int32_t mutex_lock(mutex_t *m, uint32_t timeout_ms){
+	task_t *self = task_self();
+	task_t *owner;
+	uint32_t token, deadline;
+
+	token = itc_critical_enter();
+
+	/* Ruta rápida: el mutex está libre */
+	if(m->owner == NULL){
+		mutex_take(m, self);
+		itc_critical_exit(token);
+
+		return 0;
+	}
+
+	if(m->owner == self || timeout_ms == 0){
+		itc_critical_exit(token);
+
+		errno = m->owner == self ? EDEADLK : EBUSY;
+
+		return -1;
+	}
+
+	deadline = task_deadline(timeout_ms);
+
+	/* El dueño, y los dueños de los mutex por los que espera, heredan
+	 * nuestra prioridad */
+	for(owner = m->owner; owner && owner->priority > self->priority;
+			owner = owner->mutex_wait ? owner->mutex_wait->owner : NULL){
+		task_set_priority(owner, self->priority);
+	}
+
+	self->mutex_wait = m;
+
+	if(task_block(&m->waiters, token, deadline) == 0){
+		/* mutex_unlock nos lo ha cedido */
+		return 0;
+	}
+
+	/* Ya no esperamos: el dueño deja de heredar nuestra prioridad */
+	token = itc_critical_enter();
+	self->mutex_wait = NULL;
+	mutex_update_chain(m->owner);
+	task_critical_exit(token);
+
+	errno = ETIMEDOUT;
+
+	return -1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera un mutex. Si hay tareas esperando, pasa a ser de la más prioritaria
+ * y el dueño vuelve a la prioridad que le dejen los mutex que aún tiene
+ * @param m	Mutex
+ * @return	Cero en caso de éxito o -1 si la tarea no es su dueña (EPERM)
+ */
+int32_t mutex_unlock(mutex_t *m){
+	task_t *self = task_self();
+	task_t *next;
+	uint32_t token;
+
+	token = itc_critical_enter();
+
+	if(m->owner != self){
+		itc_critical_exit(token);
+
+		errno = EPERM;
+
+		return -1;
+	}
+
+	mutex_release(m);
+
+	/* Ruta rápida: nadie espera y no hay prioridad heredada que devolver */
+	if(m->waiters.head == NULL && self->priority == self->base_priority){
+		itc_critical_exit(token);
+
+		return 0;
+	}
+
+	next = task_wake_one(&m->waiters);
+
+	if(next){
+		next->mutex_wait = NULL;
+		mutex_take(m, next);
+
+		/* El nuevo dueño hereda de las tareas que siguen esperando */
+		mutex_update_chain(next);
+	}
+
+	mutex_update_chain(self);
+	task_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,135 @@
+/*
+ * Sistemas operativos empotrados
+ * Semáforos contadores
+ */
+
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un semáforo
+ * @param s		Semáforo
+ * @param count	Cuenta inicial
+ * @param max	Cuenta máxima, 1 para un semáforo binario
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t semaphore_init(semaphore_t *s, uint32_t count, uint32_t max){
+	if(s == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	if(max == 0 || count > max){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	s->count = count;
+	s->max = max;
+	s->waiters.head = NULL;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Coge una unidad del semáforo, esperando si la cuenta es cero
+ * Si hay unidades, sólo hace una sección crítica del ITC y un decremento
+ * @param s				Semáforo
+ * @param timeout_ms	Plazo máximo de espera. 0 para no esperar o
+ * 						TASK_WAIT_FOREVER para esperar sin límite
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global
+ * 						errno: EAGAIN sin espera, ETIMEDOUT si vence el plazo
+ */
+int32_t semaphore_take(semaphore_t *s, uint32_t timeout_ms){
+	uint32_t token;
+
+	token = itc_critical_enter();
+
+	/* Ruta rápida: hay unidades */
+	if(s->count){
+		s->count--;
+		itc_critical_exit(token);
+
+		return 0;
+	}
+
+	if(timeout_ms == 0){
+		itc_critical_exit(token);
+
+		errno = EAGAIN;
+
+		return -1;
+	}
+
+	/* semaphore_give nos pasa la unidad sin llegar a contarla */
+	return task_block(&s->waiters, token, task_deadline(timeout_ms));
+}
+
+/*****************************************************************************/
+
+/**
+ * Da una unidad al semáforo, despertando a la tarea más prioritaria que
+ * espera. Se puede llamar desde los manejadores de interrupción: si la
+ * tarea despertada es más prioritaria, el cambio se hace al salir de la IRQ
+ * @param s	Semáforo
+ * @return	Cero en caso de éxito o -1 si la cuenta ya es la máxima (EOVERFLOW)
+ */
+int32_t semaphore_give(semaphore_t *s){
+	uint32_t token;
+
+	token = itc_critical_enter();
+
+	/* Ruta rápida: nadie espera */
+	if(s->waiters.head == NULL){
+		if(s->count >= s->max){
+			itc_critical_exit(token);
+
+			errno = EOVERFLOW;
+
+			return -1;
+		}
+
+		s->count++;
+		itc_critical_exit(token);
+
+		return 0;
+	}
+
+	task_wake_one(&s->waiters);
+	task_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Da una unidad al semáforo desde un manejador de interrupción
+ * @param s	Semáforo
+ * @return	Cero en caso de éxito o -1 si la cuenta ya es la máxima (EOVERFLOW)
+ */
+inline int32_t semaphore_give_isr(semaphore_t *s){
+	/* semaphore_give nunca se bloquea y task_critical_exit no cede el
+	 * procesador fuera del nivel de tarea */
+	return semaphore_give(s);
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna las unidades disponibles de un semáforo
+ * @param s	Semáforo
+ */
+inline uint32_t semaphore_count(semaphore_t *s){
+	return s->count;
+}
+
+/*****************************************************************************/
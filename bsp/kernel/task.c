@@ -0,0 +1,812 @@
+/*
+ * Sistemas operativos empotrados
+ * Núcleo expropiativo de tareas con prioridades
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "system.h"
+
+/*****************************************************************************/
+
+/**
+ * Modo USER del cpsr, en el que se ejecutan las tareas
+ */
+#define TASK_USR_MODE		0x10
+#define TASK_MODE_MASK		0x1f
+#define TASK_THUMB			0x20
+
+/**
+ * Ciclos de la restauración del contexto, que task_pick_next no puede medir:
+ * retorno de task_pick_next (3), carga del cpsr (7), ldm de r0-r14 (17),
+ * nop (1), carga del pc (3) y movs pc, lr (3)
+ */
+#define TASK_SWITCH_RESTORE_CYCLES	34
+
+/**
+ * Motivos para cambiar de tarea (task_need_resched)
+ */
+#define TASK_RESCHED_PREEMPT	(1 << 0)	/* Hay una tarea más prioritaria */
+#define TASK_RESCHED_YIELD		(1 << 1)	/* La tarea actual pasa al final de su cola */
+
+/*****************************************************************************/
+
+/**
+ * Funciones en ensamblador (task_asm.s)
+ */
+void task_switch_context (void);
+
+/*****************************************************************************/
+
+/**
+ * Tarea que representa al código que llamó a task_init (main)
+ */
+static task_t task_main;
+
+/**
+ * Tarea ociosa. Se ejecuta cuando no hay ninguna preparada y no está en las
+ * colas: su prioridad, TASK_PRIORITIES, es menor que la de cualquier otra
+ */
+static task_t task_idle;
+
+/**
+ * Lista de todas las tareas, para los informes de depuración
+ */
+static task_t *task_all;
+TASK_STACK(task_idle_stack, TASK_IDLE_STACK_SIZE);
+
+/**
+ * Tarea en ejecución. La usa task_switch_context
+ */
+task_t *task_current;
+
+/**
+ * Motivos pendientes para cambiar de tarea. Los comprueban la salida de las
+ * IRQ y las funciones que preparan tareas desde el nivel de tarea
+ */
+volatile uint32_t task_need_resched;
+
+/**
+ * Valor del contador libre al entrar en task_switch_context
+ */
+uint32_t task_switch_start;
+
+/**
+ * Colas de tareas preparadas, una por prioridad, en orden de llegada
+ * El bit p de task_ready_bitmap indica que la cola p no está vacía
+ */
+static uint32_t task_ready_bitmap;
+static task_t *task_ready_head[TASK_PRIORITIES];
+static task_t *task_ready_tail[TASK_PRIORITIES];
+
+/**
+ * Rodaja de tiempo entre tareas de la misma prioridad. Sólo está activa
+ * mientras hay tareas preparadas de la prioridad de la actual
+ */
+static systimer_t task_slice_timer;
+
+/**
+ * Estadísticas de los cambios de contexto
+ */
+static volatile task_stats_t task_stats;
+
+/*****************************************************************************/
+
+/**
+ * Indica si el código que llama se ejecuta en el nivel de tarea (modo USER)
+ * y no en un manejador de interrupción o de excepción
+ */
+inline uint32_t task_in_thread(){
+	uint32_t cpsr;
+
+	asm volatile(
+		"mrs %[cpsr], cpsr"
+		:	[cpsr] "=r" (cpsr)
+	);
+
+	return (cpsr & TASK_MODE_MASK) == TASK_USR_MODE;
+}
+
+/*****************************************************************************/
+
+/**
+ * Función de la rodaja de tiempo. Si hay otra tarea preparada de la misma
+ * prioridad, la actual pasa al final de su cola al salir de la IRQ
+ * @param arg	No se usa
+ */
+static void task_slice_expired(void *arg){
+	if(task_current != &task_idle &&
+			(task_ready_bitmap & (1 << task_current->priority))){
+		task_need_resched |= TASK_RESCHED_PREEMPT | TASK_RESCHED_YIELD;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Añade una tarea al final de la cola de su prioridad y pide un cambio de
+ * contexto si es más prioritaria que la actual
+ * Se debe llamar dentro de una sección crítica
+ * @param task	Tarea
+ */
+static void task_make_ready(task_t *task){
+	uint32_t priority = task->priority;
+
+	task->state = task_state_ready;
+	task->next = NULL;
+
+	if(task_ready_tail[priority]){
+		task_ready_tail[priority]->next = task;
+	}
+	else{
+		task_ready_head[priority] = task;
+		task_ready_bitmap |= 1 << priority;
+	}
+
+	task_ready_tail[priority] = task;
+
+	if(priority < task_current->priority){
+		task_need_resched |= TASK_RESCHED_PREEMPT;
+	}
+	else if(priority == task_current->priority &&
+			!systimer_is_active(&task_slice_timer)){
+		systimer_start(&task_slice_timer, TASK_SLICE_MS, TASK_SLICE_MS);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Saca una tarea preparada de la cola de su prioridad
+ * Se debe llamar dentro de una sección crítica
+ * @param task	Tarea
+ */
+static void task_ready_remove(task_t *task){
+	uint32_t priority = task->priority;
+	task_t **link = &task_ready_head[priority];
+	task_t *prev = NULL;
+
+	while(*link != task){
+		prev = *link;
+		link = &(*link)->next;
+	}
+
+	*link = task->next;
+
+	if(task_ready_tail[priority] == task){
+		task_ready_tail[priority] = prev;
+	}
+
+	if(task_ready_head[priority] == NULL){
+		task_ready_bitmap &= ~(1 << priority);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Añade una tarea al principio de la cola de su prioridad, para que una
+ * tarea expropiada no pierda su turno
+ * Se debe llamar con las IRQ deshabilitadas
+ * @param task	Tarea
+ */
+static void task_make_ready_first(task_t *task){
+	uint32_t priority = task->priority;
+
+	task->state = task_state_ready;
+	task->next = task_ready_head[priority];
+
+	if(task->next == NULL){
+		task_ready_tail[priority] = task;
+		task_ready_bitmap |= 1 << priority;
+	}
+
+	task_ready_head[priority] = task;
+}
+
+/*****************************************************************************/
+
+/**
+ * Elige la tarea que se va a ejecutar. La llama task_switch_context, en
+ * modo SVC o IRQ con las IRQ deshabilitadas, tras guardar el contexto de la
+ * tarea actual
+ * La tarea más prioritaria es la primera de la cola del bit de menor peso
+ * de task_ready_bitmap, así que la elección no depende del número de tareas
+ * @return	La tarea elegida, que pasa a ser task_current
+ */
+task_t *task_pick_next(){
+	task_t *prev = task_current;
+	task_t *next;
+	uint32_t priority, cycles, preempted;
+
+	preempted = prev->state == task_state_running &&
+			(task_need_resched & TASK_RESCHED_PREEMPT);
+
+	if(prev->state == task_state_running && prev != &task_idle){
+		if(task_need_resched & TASK_RESCHED_YIELD){
+			task_make_ready(prev);
+		}
+		else{
+			task_make_ready_first(prev);
+		}
+	}
+
+	if(task_ready_bitmap){
+		priority = __builtin_ctz(task_ready_bitmap);
+		next = task_ready_head[priority];
+		task_ready_head[priority] = next->next;
+
+		if(next->next == NULL){
+			task_ready_tail[priority] = NULL;
+			task_ready_bitmap &= ~(1 << priority);
+		}
+	}
+	else{
+		next = &task_idle;
+	}
+
+	next->state = task_state_running;
+	task_current = next;
+	task_need_resched = 0;
+
+	/* Sin más tareas de su prioridad, la rodaja de tiempo sobra */
+	if((next == &task_idle || !(task_ready_bitmap & (1 << next->priority))) &&
+			systimer_is_active(&task_slice_timer)){
+		systimer_stop(&task_slice_timer);
+	}
+
+	if(next != prev){
+		task_stats.switches++;
+
+		/* El tiempo ocioso se mide en los cambios de y hacia task_idle */
+		if(prev == &task_idle){
+			cpuload_idle_exit();
+		}
+		else if(next == &task_idle){
+			cpuload_idle_enter();
+		}
+
+		if(preempted){
+			task_stats.preemptions++;
+		}
+	}
+
+	/* El contador es de 16 bits */
+	cycles = ((tmr_get_count() - task_switch_start) & 0xffff) + TASK_SWITCH_RESTORE_CYCLES;
+	task_stats.last_cycles = cycles;
+
+	if(cycles > task_stats.max_cycles){
+		task_stats.max_cycles = cycles;
+	}
+
+	return next;
+}
+
+/*****************************************************************************/
+
+/**
+ * Cede el procesador desde el nivel de tarea. El cambio de contexto se hace
+ * en la llamada swi_yield, con las IRQ deshabilitadas
+ * @param token	Token de la sección crítica en la que se llama, que se cierra
+ */
+static void task_reschedule(uint32_t token){
+	itc_critical_exit(token);
+	swi_yield();
+}
+
+/*****************************************************************************/
+
+/**
+ * Añade una tarea a una cola de espera, detrás de las de igual o más
+ * prioridad
+ * Se debe llamar dentro de una sección crítica
+ * @param queue	Cola de espera
+ * @param task	Tarea
+ */
+static void task_wait_insert(task_wait_queue_t *queue, task_t *task){
+	task_t **link = &queue->head;
+
+	while(*link && (*link)->priority <= task->priority){
+		link = &(*link)->wait_next;
+	}
+
+	task->wait_next = *link;
+	*link = task;
+	task->wait_queue = queue;
+}
+
+/*****************************************************************************/
+
+/**
+ * Saca una tarea bloqueada de su cola de espera
+ * Se debe llamar dentro de una sección crítica
+ * @param task	Tarea
+ */
+static void task_wait_remove(task_t *task){
+	task_t **link = &task->wait_queue->head;
+
+	while(*link != task){
+		link = &(*link)->wait_next;
+	}
+
+	*link = task->wait_next;
+	task->wait_queue = NULL;
+}
+
+/*****************************************************************************/
+
+/**
+ * Función del temporizador de una tarea dormida o bloqueada con plazo
+ * @param arg	Tarea
+ */
+static void task_wakeup(void *arg){
+	task_t *task = (task_t *) arg;
+	uint32_t token = itc_critical_enter();
+
+	if(task->state == task_state_sleeping){
+		task_make_ready(task);
+	}
+	else if(task->state == task_state_blocked){
+		task_wait_remove(task);
+		task->wait_result = -1;
+		task_make_ready(task);
+	}
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Función de la tarea ociosa
+ * @param arg	No se usa
+ */
+static void task_idle_loop(void *arg){
+	while(1){
+		BSP_IDLE_WAIT();
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Prepara la pila de una tarea nueva con el marco que restaura
+ * task_switch_context: empieza en func con arg en r0, en modo USER y
+ * retorna a task_exit
+ * @param task	Tarea
+ * @param func	Función de la tarea
+ * @param arg	Argumento para la función
+ */
+static void task_init_frame(task_t *task, task_func_t func, void *arg){
+	uint32_t top = ((uint32_t) task->stack + task->stack_size) & ~7;
+	uint32_t *frame = (uint32_t *) top - TASK_FRAME_WORDS;
+
+	/* Para medir su uso máximo con stack_peak */
+	stack_paint(task->stack, task->stack_size);
+	memset(frame, 0, TASK_FRAME_WORDS * sizeof(uint32_t));
+
+	/* Las funciones Thumb tienen a uno el bit 0 de su dirección */
+	frame[0] = TASK_USR_MODE | (((uint32_t) func & 1) ? TASK_THUMB : 0);
+	frame[1] = (uint32_t) arg;				/* r0 */
+	frame[14] = top;						/* sp */
+	frame[15] = (uint32_t) task_exit;		/* lr */
+	frame[16] = (uint32_t) func & ~1;		/* pc */
+
+	task->sp = (uint32_t) frame;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa el planificador. El código que lo llama (main) pasa a ser la
+ * primera tarea, con prioridad TASK_PRIORITY_MAIN y la pila del modo en el
+ * que se ejecuta, que debe ser el modo USER
+ */
+void task_init(){
+	task_main.name = "main";
+	task_main.priority = TASK_PRIORITY_MAIN;
+	task_main.base_priority = TASK_PRIORITY_MAIN;
+	task_main.stack = NULL;
+	task_main.stack_size = 0;
+	task_main.events = 0;
+	task_main.wait_queue = NULL;
+	task_main.mutex_held = NULL;
+	task_main.mutex_wait = NULL;
+	task_main.state = task_state_running;
+	task_main.list_next = &task_idle;
+	systimer_setup(&task_main.timer, task_wakeup, &task_main, 0);
+
+	task_idle.name = "idle";
+	task_idle.priority = TASK_PRIORITIES;
+	task_idle.base_priority = TASK_PRIORITIES;
+	task_idle.stack = task_idle_stack;
+	task_idle.stack_size = sizeof(task_idle_stack);
+	task_idle.events = 0;
+	task_idle.state = task_state_ready;
+	task_idle.list_next = NULL;
+	task_init_frame(&task_idle, task_idle_loop, NULL);
+	task_all = &task_main;
+
+	systimer_setup(&task_slice_timer, task_slice_expired, NULL, 0);
+
+	task_current = &task_main;
+	task_need_resched = 0;
+	task_ready_bitmap = 0;
+	memset(task_ready_head, 0, sizeof(task_ready_head));
+	memset(task_ready_tail, 0, sizeof(task_ready_tail));
+	memset((void *) &task_stats, 0, sizeof(task_stats));
+
+	swi_set_yield_handler(task_switch_context);
+}
+
+/*****************************************************************************/
+
+/**
+ * Crea una tarea y la deja preparada. Si tiene más prioridad que la tarea
+ * actual, la expropia en ese momento
+ * La tarea se ejecuta en modo USER con las interrupciones habilitadas
+ * @param task			Bloque de control
+ * @param name			Nombre
+ * @param func			Función de la tarea
+ * @param arg			Argumento para la función
+ * @param priority		Prioridad, menor que TASK_PRIORITIES. 0 es la más alta
+ * @param stack			Pila, declarada con TASK_STACK
+ * @param stack_size	Tamaño de la pila en bytes, al menos TASK_STACK_MIN
+ * @return				Cero en caso de éxito o -1 en caso de error.
+ * 						La condición de error se indica en la variable global errno
+ */
+int32_t task_create(task_t *task, const char *name, task_func_t func, void *arg,
+		uint32_t priority, uint32_t *stack, uint32_t stack_size){
+	task_t *other;
+	uint32_t token;
+
+	if(task == NULL || func == NULL || stack == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	if(priority >= TASK_PRIORITIES || stack_size < TASK_STACK_MIN){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	task->name = name;
+	task->priority = priority;
+	task->base_priority = priority;
+	task->stack = stack;
+	task->stack_size = stack_size;
+	task->events = 0;
+	task->wait_mask = 0;
+	task->wait_queue = NULL;
+	task->mutex_held = NULL;
+	task->mutex_wait = NULL;
+	systimer_setup(&task->timer, task_wakeup, task, 0);
+	task_init_frame(task, func, arg);
+
+	token = itc_critical_enter();
+
+	/* Una tarea terminada se puede volver a crear sin repetirla en la lista */
+	for(other = task_all; other && other != task; other = other->list_next);
+
+	if(other == NULL){
+		task->list_next = task_all;
+		task_all = task;
+	}
+
+	task_make_ready(task);
+	task_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna la tarea en ejecución
+ */
+inline task_t *task_self(){
+	return task_current;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna la primera tarea de la lista de todas las creadas, incluidas main
+ * y la tarea ociosa. Las demás se recorren con list_next
+ */
+inline task_t *task_list(){
+	return task_all;
+}
+
+/*****************************************************************************/
+
+/**
+ * Cede el procesador a la siguiente tarea preparada de su misma prioridad
+ * Si no hay ninguna, la tarea sigue ejecutándose
+ */
+void task_yield(){
+	uint32_t token = itc_critical_enter();
+
+	task_need_resched |= TASK_RESCHED_YIELD;
+	task_reschedule(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Termina la tarea en ejecución. Se llama automáticamente cuando la función
+ * de la tarea retorna
+ */
+void task_exit(){
+	uint32_t token = itc_critical_enter();
+
+	task_current->state = task_state_dead;
+	task_reschedule(token);
+
+	/* Una tarea terminada no vuelve a planificarse */
+	while(1);
+}
+
+/*****************************************************************************/
+
+/**
+ * Duerme la tarea hasta un tick de los temporizadores del sistema
+ * Para actividades periódicas sin deriva, se suma el periodo al tick
+ * anterior en lugar de al actual
+ * @param tick	Tick de systimer_get_ticks
+ */
+void task_sleep_until(uint32_t tick){
+	uint32_t token = itc_critical_enter();
+
+	/* El estado se fija antes de arrancar el temporizador: si vence en */
+	/* seguida, task_wakeup ya encuentra la tarea dormida */
+	task_current->state = task_state_sleeping;
+	systimer_start_at(&task_current->timer, tick, 0);
+
+	task_reschedule(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Duerme la tarea durante un número de milisegundos
+ * @param ms	Milisegundos
+ */
+void task_sleep_ms(uint32_t ms){
+	uint32_t token = itc_critical_enter();
+
+	task_current->state = task_state_sleeping;
+	systimer_start(&task_current->timer, ms, 0);
+
+	task_reschedule(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Espera a que la tarea reciba alguno de los eventos indicados
+ * @param mask	Eventos que se esperan
+ * @return		Los eventos de mask recibidos, que se consumen
+ */
+uint32_t task_wait_event(uint32_t mask){
+	uint32_t token = itc_critical_enter();
+	uint32_t events;
+
+	while(!(task_current->events & mask)){
+		task_current->wait_mask = mask;
+		task_current->state = task_state_waiting;
+		task_reschedule(token);
+
+		token = itc_critical_enter();
+	}
+
+	events = task_current->events & mask;
+	task_current->events &= ~events;
+
+	itc_critical_exit(token);
+
+	return events;
+}
+
+/*****************************************************************************/
+
+/**
+ * Envía eventos a una tarea, despertándola si los esperaba
+ * Se puede llamar desde los manejadores de interrupción: si la tarea
+ * despertada tiene más prioridad, el cambio se hace al salir de la IRQ
+ * @param task		Tarea
+ * @param events	Eventos
+ */
+void task_post_event(task_t *task, uint32_t events){
+	uint32_t token = itc_critical_enter();
+
+	task->events |= events;
+
+	if(task->state == task_state_waiting && (task->events & task->wait_mask)){
+		task_make_ready(task);
+	}
+
+	task_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Cierra una sección crítica de itc_critical_enter y, si en ella se ha
+ * preparado una tarea más prioritaria y se está en el nivel de tarea, le
+ * cede el procesador. En un manejador de interrupción el cambio se hace al
+ * salir de la IRQ. Los objetos del núcleo la usan tras task_wake_one
+ * Dentro de otra sección crítica (token nulo) no se cede el procesador: el
+ * cambio espera a la próxima salida de IRQ o llamada que lo ceda
+ * @param token	Token de la sección crítica
+ */
+void task_critical_exit(uint32_t token){
+	itc_critical_exit(token);
+
+	if(task_need_resched && token && task_in_thread()){
+		swi_yield();
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Calcula el tick límite de una espera
+ * @param timeout_ms	Plazo en milisegundos o TASK_WAIT_FOREVER
+ * @return				Tick límite para task_block o TASK_WAIT_FOREVER
+ */
+uint32_t task_deadline(uint32_t timeout_ms){
+	if(timeout_ms == TASK_WAIT_FOREVER){
+		return TASK_WAIT_FOREVER;
+	}
+
+	return systimer_get_ticks() + SYSTIMER_MS_TO_TICKS(timeout_ms);
+}
+
+/*****************************************************************************/
+
+/**
+ * Bloquea la tarea actual en una cola de espera hasta que la despierte
+ * task_wake_one o venza el plazo. No se puede llamar desde un manejador
+ * de interrupción
+ * @param queue		Cola de espera
+ * @param token		Token de la sección crítica en la que se comprobó que
+ * 					había que esperar, que se cierra
+ * @param deadline	Tick límite de task_deadline o TASK_WAIT_FOREVER
+ * @return			Cero si la despertaron o -1 si venció el plazo.
+ * 					En ese caso errno vale ETIMEDOUT
+ */
+int32_t task_block(task_wait_queue_t *queue, uint32_t token, uint32_t deadline){
+	task_t *task = task_current;
+
+	task_wait_insert(queue, task);
+	task->wait_result = 0;
+	task->state = task_state_blocked;
+
+	if(deadline != TASK_WAIT_FOREVER){
+		systimer_start_at(&task->timer, deadline, 0);
+	}
+
+	task_reschedule(token);
+
+	if(task->wait_result){
+		errno = ETIMEDOUT;
+
+		return -1;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Despierta la tarea más prioritaria de una cola de espera
+ * Se debe llamar dentro de una sección crítica, también desde los
+ * manejadores de interrupción
+ * @param queue		Cola de espera
+ * @return			La tarea despertada o NULL si la cola estaba vacía
+ */
+task_t *task_wake_one(task_wait_queue_t *queue){
+	task_t *task = queue->head;
+
+	if(task){
+		queue->head = task->wait_next;
+		task->wait_queue = NULL;
+
+		if(systimer_is_active(&task->timer)){
+			systimer_stop(&task->timer);
+		}
+
+		task->wait_result = 0;
+		task_make_ready(task);
+	}
+
+	return task;
+}
+
+/*****************************************************************************/
+
+/**
+ * Cambia la prioridad efectiva de una tarea, recolocándola en su cola de
+ * preparadas o de espera. Si la tarea actual deja de ser la más prioritaria,
+ * se pide un cambio de contexto. La usa la herencia de prioridad de los
+ * mutex; base_priority no cambia
+ * Se debe llamar dentro de una sección crítica
+ * @param task		Tarea
+ * @param priority	Prioridad, como mucho TASK_PRIORITIES - 1
+ */
+void task_set_priority(task_t *task, uint32_t priority){
+	task_wait_queue_t *queue;
+
+	if(task->priority == priority){
+		return;
+	}
+
+	if(task->state == task_state_ready){
+		task_ready_remove(task);
+		task->priority = priority;
+		task_make_ready(task);
+	}
+	else if(task->state == task_state_blocked){
+		queue = task->wait_queue;
+		task_wait_remove(task);
+		task->priority = priority;
+		task_wait_insert(queue, task);
+	}
+	else{
+		task->priority = priority;
+
+		if(task == task_current && task_ready_bitmap &&
+				__builtin_ctz(task_ready_bitmap) < priority){
+			task_need_resched |= TASK_RESCHED_PREEMPT;
+		}
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas de los cambios de contexto
+ * @param stats		Estructura donde se copian las estadísticas
+ */
+void task_stats_get(task_stats_t *stats){
+	uint32_t token = itc_critical_enter();
+
+	memcpy(stats, (void *) &task_stats, sizeof(task_stats_t));
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Pone a cero las estadísticas de los cambios de contexto
+ */
+void task_stats_reset(){
+	uint32_t token = itc_critical_enter();
+
+	memset((void *) &task_stats, 0, sizeof(task_stats));
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime por la salida estándar las estadísticas de los cambios de contexto
+ */
+void task_stats_print(){
+	task_stats_t stats;
+
+	task_stats_get(&stats);
+
+	iprintf("switches %lu preemptions %lu last %lu max %lu (cycles @ %u Hz)\r\n",
+			stats.switches, stats.preemptions, stats.last_cycles,
+			stats.max_cycles, tmr_get_freq());
+}
+
+/*****************************************************************************/
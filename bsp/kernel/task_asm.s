@@ -0,0 +1,71 @@
+/*
+	Sistemas Empotrados
+	Cambio de contexto entre tareas del núcleo expropiativo
+*/
+
+	@ Contador libre del sistema: CNTR de TMR_CLOCK_ID (tmr_0)
+	.set _TMR_CLOCK_CNTR, 0x8000700A
+
+/*
+	Sección de código
+*/
+	.code 32
+	.text
+
+/*
+	Cambio de contexto completo entre tareas
+	Se entra en un modo privilegiado (SVC desde swi_yield, IRQ desde
+	excep_nonnested_irq_handler_asm) con las IRQ deshabilitadas y:
+		r0-r12:	valores de la tarea interrumpida
+		lr:		dirección en la que continúa la tarea
+		spsr:	cpsr de la tarea (modo USER)
+	Guarda el contexto en la pila de la tarea, llama a task_pick_next, que
+	elige la siguiente y retorna su bloque de control, y restaura el
+	contexto de ésta. El marco ocupa 17 palabras:
+		sp -> cpsr r0 r1 ... r12 sp lr pc
+	El sp guardado es el de la tarea antes de apilar el marco, así que al
+	restaurarlo se desapila el marco
+	La entrada se marca con el contador libre en task_switch_start para
+	medir la duración del cambio
+*/
+	.align	4
+	.globl	task_switch_context
+	.type	task_switch_context, %function
+task_switch_context:
+	stmfd	sp!, {r0, r1}
+	ldr	r0, =_TMR_CLOCK_CNTR
+	ldrh	r1, [r0]
+	ldr	r0, =task_switch_start
+	str	r1, [r0]
+
+	@ Guardamos el contexto en la pila de la tarea
+	stmdb	sp, {sp}^					@ [sp - 4] <- sp_usr
+	nop
+	ldr	r0, [sp, #-4]
+	stmdb	r0!, {lr}					@ pc
+	mov	lr, r0
+	ldmfd	sp!, {r0, r1}
+	stmdb	lr, {r0-r14}^				@ r0-r12, sp_usr y lr_usr
+	nop
+	sub	lr, lr, #60
+	mrs	r0, spsr
+	stmdb	lr!, {r0}					@ cpsr
+	ldr	r0, =task_current
+	ldr	r0, [r0]
+	str	lr, [r0]					@ task_current->sp <- marco
+
+	@ Elegimos la siguiente tarea
+	ldr	r12, =task_pick_next
+	mov	lr, pc
+	bx	r12							@ r0 <- task_current
+
+	@ Restauramos su contexto
+	ldr	lr, [r0]
+	ldmfd	lr!, {r0}
+	msr	spsr_cxsf, r0
+	ldmfd	lr, {r0-r14}^
+	nop
+	ldr	lr, [lr, #60]
+	movs	pc, lr						@ Retorno restaurando cpsr
+
+	.size	task_switch_context, .-task_switch_context
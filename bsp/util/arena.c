@@ -0,0 +1,136 @@
+/*
+ * Sistemas operativos empotrados
+ * Arenas: reserva por desplazamiento y liberación conjunta
+ */
+
+#include <errno.h>
+#include "arena.h"
+
+/*****************************************************************************/
+
+/**
+ * Alineación de las reservas, la que exige el AAPCS para cualquier tipo
+ */
+#define ARENA_ALIGN		8
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una arena vacía
+ * @param arena	Arena
+ * @param mem	Zona de memoria, normalmente de ARENA_BUFFER
+ * @param bytes	Tamaño de la zona
+ * @return		Cero en caso de éxito o -1 en caso de error.
+ * 				La condición de error se indica en la variable global errno
+ */
+int32_t arena_init(arena_t *arena, void *mem, size_t bytes){
+	uintptr_t start, end;
+
+	if(arena == NULL || mem == NULL){
+		errno = EFAULT;
+
+		return -1;
+	}
+
+	start = ((uintptr_t) mem + ARENA_ALIGN - 1) & ~(uintptr_t) (ARENA_ALIGN - 1);
+	end = (uintptr_t) mem + bytes;
+
+	if(end < start){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	arena->start = (uint8_t *) start;
+	arena->end = (uint8_t *) end;
+	arena->top = arena->start;
+	arena->peak = arena->start;
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva memoria de una arena, alineada a 8 bytes
+ * @param arena	Arena
+ * @param size	Tamaño en bytes
+ * @return		Puntero o NULL si no cabe (ENOMEM)
+ */
+void *arena_alloc(arena_t *arena, size_t size){
+	uint8_t *ptr = arena->top;
+
+	/* top siempre está alineado: basta con redondear el tamaño */
+	size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+	if(size > (size_t) (arena->end - ptr)){
+		errno = ENOMEM;
+
+		return NULL;
+	}
+
+	arena->top = ptr + size;
+
+	if(arena->top > arena->peak){
+		arena->peak = arena->top;
+	}
+
+	return ptr;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna un punto de control con el estado actual de la arena. Los puntos
+ * de control se pueden anidar: se restauran en orden inverso
+ * @param arena	Arena
+ */
+inline arena_checkpoint_t arena_save(arena_t *arena){
+	return arena->top;
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera todo lo reservado desde un punto de control
+ * @param arena			Arena
+ * @param checkpoint	Punto de control de arena_save
+ */
+inline void arena_restore(arena_t *arena, arena_checkpoint_t checkpoint){
+	/* Un punto de control posterior al estado actual ya no es válido */
+	if(checkpoint >= arena->start && checkpoint <= arena->top){
+		arena->top = checkpoint;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera todo lo reservado en la arena
+ * @param arena	Arena
+ */
+inline void arena_reset(arena_t *arena){
+	arena->top = arena->start;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna los bytes reservados en la arena
+ * @param arena	Arena
+ */
+inline size_t arena_used(arena_t *arena){
+	return arena->top - arena->start;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el máximo de bytes reservados en la arena, para dimensionarla
+ * @param arena	Arena
+ */
+inline size_t arena_peak(arena_t *arena){
+	return arena->peak - arena->start;
+}
+
+/*****************************************************************************/
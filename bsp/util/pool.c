@@ -0,0 +1,249 @@
+/*
+ * Sistemas operativos empotrados
+ * Pools de bloques de tamaño fijo, utilizables desde las interrupciones
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include "itc.h"
+#include "pool.h"
+
+/*****************************************************************************/
+
+/**
+ * Tamaño de un bloque de una clase, redondeado a múltiplos de 8 bytes
+ */
+#define POOL_BLOCK_SIZE(bytes)	(((bytes) + 7) & ~7)
+
+/**
+ * Memoria de cada clase, en palabras dobles para alinearla a 8 bytes
+ */
+#define POOL_STORAGE(bytes, blocks)	\
+	static uint64_t pool_storage_##bytes[(blocks) * POOL_BLOCK_SIZE(bytes) / 8];
+
+POOL_CLASSES(POOL_STORAGE)
+
+/**
+ * Número de clases
+ */
+#define POOL_COUNT(bytes, blocks)	+ 1
+
+#define POOL_CLASS_COUNT	(0 POOL_CLASSES(POOL_COUNT))
+
+/*****************************************************************************/
+
+/**
+ * Bloque libre: se enlaza a través de su primera palabra
+ */
+typedef struct pool_block{
+	struct pool_block *next;
+} pool_block_t;
+
+/**
+ * Estado de una clase
+ */
+typedef struct{
+	uint8_t *start;					/* Primer bloque */
+	uint8_t *end;					/* Fin del último bloque */
+	pool_block_t *free_list;		/* Bloques libres */
+	pool_stats_t stats;				/* Estadísticas */
+} pool_class_t;
+
+#define POOL_CLASS(bytes, blocks)	\
+	{ (uint8_t *) pool_storage_##bytes, (uint8_t *) pool_storage_##bytes + sizeof(pool_storage_##bytes), \
+	  NULL, { POOL_BLOCK_SIZE(bytes), (blocks), 0, 0, 0, 0 } },
+
+static pool_class_t pool_class[POOL_CLASS_COUNT] = { POOL_CLASSES(POOL_CLASS) };
+
+/*****************************************************************************/
+
+/**
+ * Inicializa los pools, dejando libres todos sus bloques
+ */
+void pool_init(){
+	pool_class_t *class;
+	pool_block_t *block;
+	uint32_t i, j;
+
+	for(i = 0; i < POOL_CLASS_COUNT; i++){
+		class = &pool_class[i];
+		class->free_list = NULL;
+
+		/* Enlazamos los bloques de modo que el primero quede al principio */
+		for(j = class->stats.blocks; j > 0; j--){
+			block = (pool_block_t *) (class->start + (j - 1) * class->stats.block_size);
+			block->next = class->free_list;
+			class->free_list = block;
+		}
+
+		class->stats.free = class->stats.blocks;
+		class->stats.min_free = class->stats.blocks;
+		class->stats.allocs = 0;
+		class->stats.failures = 0;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva un bloque de la clase más pequeña en la que cabe size y que tenga
+ * bloques libres. Se puede llamar desde los manejadores de interrupción: el
+ * coste no depende de la ocupación, sólo del número de clases
+ * @param size	Tamaño en bytes
+ * @return		El bloque o NULL si no queda ninguno (ENOMEM) o
+ * 				ninguna clase es tan grande (EINVAL)
+ */
+void *pool_alloc(size_t size){
+	pool_class_t *class = pool_class;
+	pool_class_t *end = pool_class + POOL_CLASS_COUNT;
+	pool_block_t *block = NULL;
+	uint32_t token;
+
+	while(class < end && class->stats.block_size < size){
+		class++;
+	}
+
+	if(class == end){
+		errno = EINVAL;
+
+		return NULL;
+	}
+
+	token = itc_critical_enter();
+
+	/* Si la clase justa está agotada, se usa la siguiente más grande */
+	for(; class < end; class++){
+		block = class->free_list;
+
+		if(block){
+			class->free_list = block->next;
+			class->stats.allocs++;
+
+			if(--class->stats.free < class->stats.min_free){
+				class->stats.min_free = class->stats.free;
+			}
+			break;
+		}
+
+		class->stats.failures++;
+	}
+
+	itc_critical_exit(token);
+
+	if(block == NULL){
+		errno = ENOMEM;
+	}
+
+	return block;
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera un bloque de pool_alloc. Se puede llamar desde los manejadores de
+ * interrupción
+ * @param block	Bloque
+ * @return		Cero en caso de éxito o -1 si el bloque no es de un pool
+ * 				(EINVAL)
+ */
+int32_t pool_free(void *block){
+	pool_class_t *class;
+	uint8_t *p = block;
+	uint32_t token;
+
+	for(class = pool_class; class < pool_class + POOL_CLASS_COUNT; class++){
+		if(p >= class->start && p < class->end){
+			break;
+		}
+	}
+
+	if(class == pool_class + POOL_CLASS_COUNT ||
+			(p - class->start) % class->stats.block_size){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	token = itc_critical_enter();
+
+	((pool_block_t *) block)->next = class->free_list;
+	class->free_list = block;
+	class->stats.free++;
+
+	itc_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el número de clases de tamaño
+ */
+inline uint32_t pool_classes(){
+	return POOL_CLASS_COUNT;
+}
+
+/*****************************************************************************/
+
+/**
+ * Copia las estadísticas de una clase de tamaño
+ * @param index	Índice de la clase, en orden creciente de tamaño
+ * @param stats	Donde se copian las estadísticas
+ * @return		Cero en caso de éxito o -1 si la clase no existe (EINVAL)
+ */
+int32_t pool_stats_get(uint32_t index, pool_stats_t *stats){
+	uint32_t token;
+
+	if(index >= POOL_CLASS_COUNT){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	token = itc_critical_enter();
+	*stats = pool_class[index].stats;
+	itc_critical_exit(token);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Pone a cero los contadores de reservas y el mínimo de bloques libres de
+ * todas las clases
+ */
+void pool_stats_reset(){
+	uint32_t token = itc_critical_enter();
+	uint32_t i;
+
+	for(i = 0; i < POOL_CLASS_COUNT; i++){
+		pool_class[i].stats.min_free = pool_class[i].stats.free;
+		pool_class[i].stats.allocs = 0;
+		pool_class[i].stats.failures = 0;
+	}
+
+	itc_critical_exit(token);
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime las estadísticas de todas las clases
+ */
+void pool_stats_print(){
+	pool_stats_t stats;
+	uint32_t i;
+
+	iprintf("size blocks free min allocs failures\r\n");
+
+	for(i = 0; i < POOL_CLASS_COUNT; i++){
+		pool_stats_get(i, &stats);
+		iprintf("%4lu %6lu %4lu %3lu %6lu %8lu\r\n", stats.block_size,
+				stats.blocks, stats.free, stats.min_free, stats.allocs,
+				stats.failures);
+	}
+}
+
+/*****************************************************************************/
@@ -0,0 +1,295 @@
+/*
+ * Sistemas operativos empotrados
+ * Rueda jerárquica de temporizadores software
+ */
+
+#include <stddef.h>
+#include "timer_wheel.h"
+
+/*****************************************************************************/
+
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS - 1)
+
+/**
+ * Máximo intervalo que cubre la rueda
+ */
+#define TIMER_WHEEL_RANGE	((uint32_t) 1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+/*****************************************************************************/
+
+/**
+ * Enlaza un temporizador en la ranura que le corresponde según su
+ * vencimiento y el tick actual de la rueda
+ * @param wheel		Rueda
+ * @param timer		Temporizador (no enlazado)
+ */
+static void timer_wheel_link(timer_wheel_t *wheel, timer_wheel_timer_t *timer){
+	timer_wheel_timer_t **slot;
+	uint32_t expires = timer->expires;
+	uint32_t delta = expires - wheel->now;
+	uint32_t level;
+
+	if((int32_t) delta < 0){
+		/* Ya ha vencido: lo procesamos en el siguiente tick */
+		expires = wheel->now;
+		delta = 0;
+	}
+	else if(delta >= TIMER_WHEEL_RANGE){
+		/* Demasiado lejos: lo dejamos en la última ranura alcanzable */
+		expires = wheel->now + TIMER_WHEEL_RANGE - 1;
+		delta = TIMER_WHEEL_RANGE - 1;
+	}
+
+	/* El nivel es el primero cuyo alcance cubre el intervalo */
+	for(level = 0; level < TIMER_WHEEL_LEVELS - 1; level++){
+		if(delta < ((uint32_t) 1 << (TIMER_WHEEL_BITS * (level + 1)))){
+			break;
+		}
+	}
+
+	slot = &wheel->slots[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+
+	timer->next = *slot;
+
+	if(*slot){
+		(*slot)->pprev = &timer->next;
+	}
+
+	*slot = timer;
+	timer->pprev = slot;
+}
+
+/*****************************************************************************/
+
+/**
+ * Desenlaza un temporizador de su ranura
+ * @param timer		Temporizador (enlazado)
+ */
+static void timer_wheel_unlink(timer_wheel_timer_t *timer){
+	*timer->pprev = timer->next;
+
+	if(timer->next){
+		timer->next->pprev = timer->pprev;
+	}
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/*****************************************************************************/
+
+/**
+ * Recoloca en los niveles inferiores los temporizadores de una ranura
+ * @param wheel		Rueda
+ * @param level		Nivel de la ranura
+ * @param index		Índice de la ranura
+ * @return			El índice de la ranura, para saber si hay que seguir
+ * 					recolocando el nivel superior
+ */
+static uint32_t timer_wheel_cascade(timer_wheel_t *wheel, uint32_t level, uint32_t index){
+	timer_wheel_timer_t *timer = wheel->slots[level][index];
+	timer_wheel_timer_t *next;
+
+	wheel->slots[level][index] = NULL;
+
+	while(timer){
+		next = timer->next;
+		timer_wheel_link(wheel, timer);
+		timer = next;
+	}
+
+	return index;
+}
+
+/*****************************************************************************/
+
+/**
+ * Calcula el primer tick en el que la rueda tiene trabajo: el vencimiento
+ * más próximo del nivel 0 o la recolocación de la primera ranura ocupada de
+ * los niveles superiores, lo que antes ocurra
+ * @param wheel		Rueda
+ * @param next		Donde se almacena el tick
+ * @return			0 si no hay temporizadores activos
+ */
+uint32_t timer_wheel_next_expiry(timer_wheel_t *wheel, uint32_t *next){
+	uint32_t now = wheel->now;
+	uint32_t best = TIMER_WHEEL_RANGE;
+	uint32_t level, shift, base, k;
+
+	if(wheel->count == 0){
+		return 0;
+	}
+
+	/* En el nivel 0 la ranura k posiciones por delante vence en now + k */
+	for(k = 0; k < TIMER_WHEEL_SLOTS; k++){
+		if(wheel->slots[0][(now + k) & TIMER_WHEEL_MASK]){
+			best = k;
+			break;
+		}
+	}
+
+	/* Las ranuras del nivel l se recolocan al empezar cada bloque de */
+	/* 2^(BITS*l) ticks. El primer bloque es el actual si now es su inicio, */
+	/* porque aún no se ha procesado */
+	for(level = 1; level < TIMER_WHEEL_LEVELS; level++){
+		shift = TIMER_WHEEL_BITS * level;
+		base = (now >> shift) + ((now & (((uint32_t) 1 << shift) - 1)) != 0);
+
+		/* Los niveles superiores no pueden adelantarse a lo encontrado */
+		if(((base << shift) - now) >= best){
+			break;
+		}
+
+		for(k = 0; k < TIMER_WHEEL_SLOTS; k++){
+			if(wheel->slots[level][(base + k) & TIMER_WHEEL_MASK]){
+				if((((base + k) << shift) - now) < best){
+					best = ((base + k) << shift) - now;
+				}
+				break;
+			}
+		}
+	}
+
+	*next = now + best;
+
+	return 1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una rueda de temporizadores
+ * @param wheel	Rueda
+ * @param now	Tick actual
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t now){
+	uint32_t level, index;
+
+	for(level = 0; level < TIMER_WHEEL_LEVELS; level++){
+		for(index = 0; index < TIMER_WHEEL_SLOTS; index++){
+			wheel->slots[level][index] = NULL;
+		}
+	}
+
+	wheel->now = now;
+	wheel->count = 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa un temporizador
+ * @param timer		Temporizador
+ * @param callback	Función a llamar al vencer
+ * @param arg		Argumento para la función
+ */
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, timer_wheel_callback_t callback, void *arg){
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->expires = 0;
+	timer->callback = callback;
+	timer->arg = arg;
+}
+
+/*****************************************************************************/
+
+/**
+ * Arranca un temporizador, o cambia su vencimiento si ya estaba activo. O(1)
+ * @param wheel		Rueda
+ * @param timer		Temporizador
+ * @param expires	Tick de vencimiento. Si ya ha pasado, vence en el
+ * 					siguiente tick procesado
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint32_t expires){
+	if(timer->pprev){
+		timer_wheel_unlink(timer);
+	}
+	else{
+		wheel->count++;
+	}
+
+	timer->expires = expires;
+	timer_wheel_link(wheel, timer);
+}
+
+/*****************************************************************************/
+
+/**
+ * Detiene un temporizador. No hace nada si no estaba activo. O(1)
+ * @param wheel		Rueda
+ * @param timer		Temporizador
+ */
+void timer_wheel_remove(timer_wheel_t *wheel, timer_wheel_timer_t *timer){
+	if(timer->pprev){
+		timer_wheel_unlink(timer);
+		wheel->count--;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna 1 si el temporizador está activo
+ * @param timer		Temporizador
+ */
+inline uint32_t timer_wheel_is_pending(timer_wheel_timer_t *timer){
+	return timer->pprev != NULL;
+}
+
+/*****************************************************************************/
+
+/**
+ * Procesa todos los ticks hasta now, incluido, llamando a las funciones de
+ * los temporizadores vencidos. El coste por tick es O(1) amortizado y los
+ * ticks sin trabajo se saltan
+ * @param wheel	Rueda
+ * @param now	Tick actual
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, uint32_t now){
+	timer_wheel_timer_t *timer;
+	uint32_t index, level, next;
+
+	while((int32_t) (now - wheel->now) >= 0){
+		/* Sin temporizadores activos no hay nada que procesar */
+		if(wheel->count == 0){
+			wheel->now = now + 1;
+			break;
+		}
+
+		index = wheel->now & TIMER_WHEEL_MASK;
+
+		/* Saltamos los ticks sin vencimientos ni recolocaciones pendientes */
+		if(index != 0 && wheel->slots[0][index] == NULL){
+			timer_wheel_next_expiry(wheel, &next);
+
+			if((int32_t) (next - now) > 0){
+				wheel->now = now + 1;
+				break;
+			}
+
+			wheel->now = next;
+			continue;
+		}
+
+		/* Al completar una vuelta de un nivel se recoloca la siguiente */
+		/* ranura del nivel superior */
+		for(level = 1; level < TIMER_WHEEL_LEVELS && index == 0; level++){
+			index = timer_wheel_cascade(wheel, level,
+					(wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+		}
+
+		index = wheel->now & TIMER_WHEEL_MASK;
+
+		/* La función del temporizador puede volver a arrancarlo, así que */
+		/* lo desenlazamos antes de llamarla */
+		while((timer = wheel->slots[0][index]) != NULL){
+			timer_wheel_unlink(timer);
+			wheel->count--;
+			timer->callback(timer->arg);
+		}
+
+		wheel->now++;
+	}
+}
+
+/*****************************************************************************/
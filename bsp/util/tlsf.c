@@ -0,0 +1,481 @@
+/*
+ * Sistemas operativos empotrados
+ * Gestor de memoria dinámica TLSF (two-level segregated fit)
+ */
+
+#include <errno.h>
+#include "tlsf.h"
+
+/*****************************************************************************/
+
+/**
+ * Bits de estado en el campo size de la cabecera
+ */
+#define TLSF_BLOCK_FREE			(1 << 0)	/* El bloque está libre */
+#define TLSF_BLOCK_PREV_FREE	(1 << 1)	/* El bloque anterior está libre */
+#define TLSF_BLOCK_FLAGS		(TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+
+/**
+ * Tamaño de la cabecera de un bloque reservado y mínima carga útil, que
+ * debe dar cabida a los enlaces de las listas de libres
+ */
+#define TLSF_HEADER_SIZE		offsetof(tlsf_block_t, next_free)
+#define TLSF_MIN_SIZE			(sizeof(tlsf_block_t) - TLSF_HEADER_SIZE)
+
+/**
+ * Máxima carga útil de un bloque
+ */
+#define TLSF_MAX_SIZE			(((uint32_t) 1 << TLSF_FL_MAX) - TLSF_ALIGN)
+
+/*****************************************************************************/
+
+/**
+ * Posición del bit más significativo y del menos significativo. El
+ * ARM7TDMI no tiene CLZ: libgcc las calcula con una tabla
+ */
+#define tlsf_fls(x)		(31 - __builtin_clz(x))
+#define tlsf_ffs(x)		(__builtin_ctz(x))
+
+/*****************************************************************************/
+
+/**
+ * Tamaño de la carga útil de un bloque
+ */
+static inline uint32_t tlsf_block_size(const tlsf_block_t *block){
+	return block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+/**
+ * Bloque siguiente en memoria
+ */
+static inline tlsf_block_t *tlsf_block_next(const tlsf_block_t *block){
+	return (tlsf_block_t *) ((uint8_t *) block + TLSF_HEADER_SIZE + tlsf_block_size(block));
+}
+
+/**
+ * Cabecera a partir de la carga útil y viceversa
+ */
+static inline tlsf_block_t *tlsf_block_from_ptr(void *ptr){
+	return (tlsf_block_t *) ((uint8_t *) ptr - TLSF_HEADER_SIZE);
+}
+
+static inline void *tlsf_block_to_ptr(tlsf_block_t *block){
+	return (uint8_t *) block + TLSF_HEADER_SIZE;
+}
+
+/*****************************************************************************/
+
+/**
+ * Calcula la lista en la que se guarda un bloque libre de un tamaño
+ * @param size	Tamaño de la carga útil
+ * @param fl	Índice de primer nivel
+ * @param sl	Índice de segundo nivel
+ */
+static inline void tlsf_mapping(uint32_t size, uint32_t *fl, uint32_t *sl){
+	uint32_t bit;
+
+	if(size < TLSF_SMALL_BLOCK){
+		*fl = 0;
+		*sl = size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT);
+	}
+	else{
+		bit = tlsf_fls(size);
+		*sl = (size >> (bit - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+		*fl = bit - TLSF_FL_SHIFT + 1;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Calcula la primera lista cuyos bloques tienen todos al menos un tamaño,
+ * redondeándolo al siguiente límite de lista
+ * @param size	Tamaño de la carga útil
+ * @param fl	Índice de primer nivel
+ * @param sl	Índice de segundo nivel
+ */
+static inline void tlsf_mapping_search(uint32_t size, uint32_t *fl, uint32_t *sl){
+	if(size >= TLSF_SMALL_BLOCK){
+		size += (1 << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+	}
+
+	tlsf_mapping(size, fl, sl);
+}
+
+/*****************************************************************************/
+
+/**
+ * Busca una lista no vacía a partir de la indicada
+ * @param tlsf	Estructura de gestión
+ * @param fl	Índice de primer nivel, se actualiza
+ * @param sl	Índice de segundo nivel, se actualiza
+ * @return		Primer bloque de la lista o NULL si no hay ninguna
+ */
+static inline tlsf_block_t *tlsf_search(tlsf_t *tlsf, uint32_t *fl, uint32_t *sl){
+	uint32_t sl_map, fl_map;
+
+	if(*fl >= TLSF_FL_COUNT){
+		return NULL;
+	}
+
+	sl_map = tlsf->sl_bitmap[*fl] & (~0u << *sl);
+
+	if(sl_map == 0){
+		fl_map = *fl + 1 < 32 ? tlsf->fl_bitmap & (~0u << (*fl + 1)) : 0;
+
+		if(fl_map == 0){
+			return NULL;
+		}
+
+		*fl = tlsf_ffs(fl_map);
+		sl_map = tlsf->sl_bitmap[*fl];
+	}
+
+	*sl = tlsf_ffs(sl_map);
+
+	return tlsf->blocks[*fl][*sl];
+}
+
+/*****************************************************************************/
+
+/**
+ * Añade un bloque libre a su lista
+ * @param tlsf	Estructura de gestión
+ * @param block	Bloque
+ */
+static void tlsf_insert(tlsf_t *tlsf, tlsf_block_t *block){
+	uint32_t fl, sl;
+	tlsf_block_t *head;
+
+	tlsf_mapping(tlsf_block_size(block), &fl, &sl);
+
+	head = tlsf->blocks[fl][sl];
+	block->next_free = head;
+	block->prev_free = NULL;
+
+	if(head){
+		head->prev_free = block;
+	}
+
+	tlsf->blocks[fl][sl] = block;
+	tlsf->fl_bitmap |= 1 << fl;
+	tlsf->sl_bitmap[fl] |= 1 << sl;
+	tlsf->free += tlsf_block_size(block);
+}
+
+/*****************************************************************************/
+
+/**
+ * Quita un bloque libre de su lista
+ * @param tlsf	Estructura de gestión
+ * @param block	Bloque
+ */
+static void tlsf_remove(tlsf_t *tlsf, tlsf_block_t *block){
+	uint32_t fl, sl;
+
+	tlsf_mapping(tlsf_block_size(block), &fl, &sl);
+
+	if(block->next_free){
+		block->next_free->prev_free = block->prev_free;
+	}
+
+	if(block->prev_free){
+		block->prev_free->next_free = block->next_free;
+	}
+	else{
+		tlsf->blocks[fl][sl] = block->next_free;
+
+		if(block->next_free == NULL){
+			tlsf->sl_bitmap[fl] &= ~(1 << sl);
+
+			if(tlsf->sl_bitmap[fl] == 0){
+				tlsf->fl_bitmap &= ~(1 << fl);
+			}
+		}
+	}
+
+	tlsf->free -= tlsf_block_size(block);
+}
+
+/*****************************************************************************/
+
+/**
+ * Recorta un bloque ocupado a un tamaño y devuelve el resto, si da para un
+ * bloque, a las listas de libres. El bloque siguiente debe estar ocupado
+ * @param tlsf	Estructura de gestión
+ * @param block	Bloque
+ * @param size	Tamaño ajustado de la carga útil
+ */
+static void tlsf_trim(tlsf_t *tlsf, tlsf_block_t *block, uint32_t size){
+	uint32_t remain = tlsf_block_size(block) - size;
+	tlsf_block_t *rest, *next;
+
+	if(remain < sizeof(tlsf_block_t)){
+		return;
+	}
+
+	block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+
+	rest = tlsf_block_next(block);
+	rest->size = (remain - TLSF_HEADER_SIZE) | TLSF_BLOCK_FREE;
+
+	next = tlsf_block_next(rest);
+	next->prev_phys = rest;
+	next->size |= TLSF_BLOCK_PREV_FREE;
+
+	tlsf_insert(tlsf, rest);
+}
+
+/*****************************************************************************/
+
+/**
+ * Redondea un tamaño pedido a la carga útil de un bloque
+ * @param size	Tamaño pedido
+ * @return		Tamaño ajustado o 0 si es demasiado grande
+ */
+static inline uint32_t tlsf_adjust_size(size_t size){
+	if(size > TLSF_MAX_SIZE){
+		return 0;
+	}
+
+	size = (size + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+
+	return size < TLSF_MIN_SIZE ? TLSF_MIN_SIZE : size;
+}
+
+/*****************************************************************************/
+
+/**
+ * Actualiza el máximo de bytes ocupados
+ * @param tlsf	Estructura de gestión
+ */
+static inline void tlsf_update_peak(tlsf_t *tlsf){
+	if(tlsf->size - tlsf->free > tlsf->peak){
+		tlsf->peak = tlsf->size - tlsf->free;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Inicializa una zona de memoria como un único bloque libre
+ * @param tlsf	Estructura de gestión
+ * @param mem	Zona de memoria
+ * @param bytes	Tamaño de la zona
+ * @return		Cero en caso de éxito o -1 si la zona es demasiado pequeña o
+ * 				demasiado grande (EINVAL)
+ */
+int32_t tlsf_init(tlsf_t *tlsf, void *mem, size_t bytes){
+	uintptr_t start = ((uintptr_t) mem + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1);
+	uintptr_t end = ((uintptr_t) mem + bytes) & ~(TLSF_ALIGN - 1);
+	tlsf_block_t *block, *sentinel;
+	uint32_t fl, sl, size;
+
+	/* Un bloque libre mínimo y la cabecera del centinela final */
+	if(end < start || end - start < sizeof(tlsf_block_t) + TLSF_HEADER_SIZE ||
+			end - start - 2 * TLSF_HEADER_SIZE > TLSF_MAX_SIZE){
+		errno = EINVAL;
+
+		return -1;
+	}
+
+	tlsf->fl_bitmap = 0;
+
+	for(fl = 0; fl < TLSF_FL_COUNT; fl++){
+		tlsf->sl_bitmap[fl] = 0;
+
+		for(sl = 0; sl < TLSF_SL_COUNT; sl++){
+			tlsf->blocks[fl][sl] = NULL;
+		}
+	}
+
+	size = end - start - 2 * TLSF_HEADER_SIZE;
+
+	block = (tlsf_block_t *) start;
+	block->prev_phys = NULL;
+	block->size = size | TLSF_BLOCK_FREE;
+
+	/* El centinela es un bloque vacío y ocupado: nunca se fusiona */
+	sentinel = tlsf_block_next(block);
+	sentinel->prev_phys = block;
+	sentinel->size = TLSF_BLOCK_PREV_FREE;
+
+	tlsf->size = size;
+	tlsf->free = 0;
+	tlsf->peak = 0;
+	tlsf_insert(tlsf, block);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Reserva un bloque en tiempo constante
+ * @param tlsf	Estructura de gestión
+ * @param size	Tamaño en bytes
+ * @return		Puntero alineado a 8 bytes o NULL si no hay un bloque libre
+ * 				suficientemente grande
+ */
+void *tlsf_malloc(tlsf_t *tlsf, size_t size){
+	uint32_t adjusted = tlsf_adjust_size(size);
+	uint32_t fl, sl;
+	tlsf_block_t *block;
+
+	if(adjusted == 0){
+		return NULL;
+	}
+
+	tlsf_mapping_search(adjusted, &fl, &sl);
+	block = tlsf_search(tlsf, &fl, &sl);
+
+	if(block == NULL){
+		return NULL;
+	}
+
+	tlsf_remove(tlsf, block);
+
+	block->size &= ~TLSF_BLOCK_FREE;
+	tlsf_block_next(block)->size &= ~TLSF_BLOCK_PREV_FREE;
+
+	tlsf_trim(tlsf, block, adjusted);
+	tlsf_update_peak(tlsf);
+
+	return tlsf_block_to_ptr(block);
+}
+
+/*****************************************************************************/
+
+/**
+ * Libera un bloque en tiempo constante, fusionándolo con sus vecinos libres
+ * @param tlsf	Estructura de gestión
+ * @param ptr	Bloque de tlsf_malloc o NULL
+ */
+void tlsf_free(tlsf_t *tlsf, void *ptr){
+	tlsf_block_t *block, *prev, *next;
+
+	if(ptr == NULL){
+		return;
+	}
+
+	block = tlsf_block_from_ptr(ptr);
+	block->size |= TLSF_BLOCK_FREE;
+
+	/* Los tamaños son múltiplos de 8: al sumarlos no cambian los bits de estado */
+	if(block->size & TLSF_BLOCK_PREV_FREE){
+		prev = block->prev_phys;
+		tlsf_remove(tlsf, prev);
+		prev->size += TLSF_HEADER_SIZE + tlsf_block_size(block);
+		block = prev;
+	}
+
+	next = tlsf_block_next(block);
+
+	if(next->size & TLSF_BLOCK_FREE){
+		tlsf_remove(tlsf, next);
+		block->size += TLSF_HEADER_SIZE + tlsf_block_size(next);
+		next = tlsf_block_next(block);
+	}
+
+	next->prev_phys = block;
+	next->size |= TLSF_BLOCK_PREV_FREE;
+
+	tlsf_insert(tlsf, block);
+}
+
+/*****************************************************************************/
+
+/**
+ * Cambia el tamaño de un bloque sin moverlo, en tiempo constante. Para
+ * crecer absorbe el bloque siguiente si está libre
+ * @param tlsf	Estructura de gestión
+ * @param ptr	Bloque de tlsf_malloc
+ * @param size	Nuevo tamaño en bytes
+ * @return		ptr o NULL si no se puede cambiar sin moverlo
+ */
+void *tlsf_resize(tlsf_t *tlsf, void *ptr, size_t size){
+	tlsf_block_t *block = tlsf_block_from_ptr(ptr);
+	tlsf_block_t *next = tlsf_block_next(block);
+	uint32_t adjusted = tlsf_adjust_size(size);
+	uint32_t current = tlsf_block_size(block);
+
+	if(adjusted == 0){
+		return NULL;
+	}
+
+	if(adjusted > current){
+		if(!(next->size & TLSF_BLOCK_FREE) ||
+				current + TLSF_HEADER_SIZE + tlsf_block_size(next) < adjusted){
+			return NULL;
+		}
+
+		tlsf_remove(tlsf, next);
+		block->size += TLSF_HEADER_SIZE + tlsf_block_size(next);
+		tlsf_block_next(block)->size &= ~TLSF_BLOCK_PREV_FREE;
+	}
+	else if(next->size & TLSF_BLOCK_FREE){
+		/* Al encoger, el bloque libre siguiente absorbe lo que sobra */
+		tlsf_remove(tlsf, next);
+		block->size += TLSF_HEADER_SIZE + tlsf_block_size(next);
+		tlsf_block_next(block)->size &= ~TLSF_BLOCK_PREV_FREE;
+	}
+
+	tlsf_trim(tlsf, block, adjusted);
+	tlsf_update_peak(tlsf);
+
+	return ptr;
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna los bytes utilizables de un bloque, que pueden ser más de los
+ * pedidos
+ * @param ptr	Bloque de tlsf_malloc
+ */
+inline size_t tlsf_usable_size(void *ptr){
+	return tlsf_block_size(tlsf_block_from_ptr(ptr));
+}
+
+/*****************************************************************************/
+
+/**
+ * Calcula las estadísticas de una zona. Para hallar el mayor bloque libre
+ * recorre la lista de libres más alta. La mayor petición que se puede
+ * servir es su tamaño redondeado hacia abajo al inicio de su lista, porque
+ * tlsf_malloc redondea las peticiones hacia arriba al inicio de la lista
+ * siguiente
+ * @param tlsf	Estructura de gestión
+ * @param stats	Donde se copian las estadísticas
+ */
+void tlsf_stats_get(tlsf_t *tlsf, tlsf_stats_t *stats){
+	tlsf_block_t *block;
+	uint32_t fl, sl;
+
+	stats->size = tlsf->size;
+	stats->used = tlsf->size - tlsf->free;
+	stats->peak = tlsf->peak;
+	stats->free = tlsf->free;
+	stats->largest_free = 0;
+
+	if(tlsf->fl_bitmap){
+		fl = tlsf_fls(tlsf->fl_bitmap);
+		sl = tlsf_fls(tlsf->sl_bitmap[fl]);
+
+		for(block = tlsf->blocks[fl][sl]; block; block = block->next_free){
+			if(tlsf_block_size(block) > stats->largest_free){
+				stats->largest_free = tlsf_block_size(block);
+			}
+		}
+	}
+
+	/* Inicio de la lista del bloque: tlsf_mapping_search no lo redondea */
+	if(stats->largest_free >= TLSF_SMALL_BLOCK){
+		stats->largest_free &= ~((1 << (tlsf_fls(stats->largest_free) - TLSF_SL_LOG2)) - 1);
+	}
+
+	stats->fragmentation = stats->free ?
+			1000 - (uint32_t) ((uint64_t) stats->largest_free * 1000 / stats->free) : 0;
+}
+
+/*****************************************************************************/
@@ -1,4 +1,122 @@
+/*****************************************************************************/
+/*                                                                           */
+/* Sistemas Empotrados                                                       */
+/* El "hola mundo" en la Redwire EconoTAG en C++, con corrutinas             */
+/*                                                                           */
+/*****************************************************************************/
 
+/*
+ * Se compila y se enlaza contra el BSP con "make cpp" desde app/
+ */
+
+#include <string.h>
+#include "coroutine.h"
+#include "reg.h"
+
+/*
+ * Constantes relativas a la plataforma
+ */
+
+/* El led rojo está en el GPIO 44 */
+#define RED_LED gpio_pin_44
+
+/* Registro DATA del puerto de los GPIO 32 a 63 y bit del led rojo en él */
+#define LED_PORT_DATA (((volatile uint32_t *) GPIO_BASE)[3])
+typedef reg_field<RED_LED - 32, 1> red_led;
+
+static_assert(red_led::mask == 0x1000, "El led rojo es el bit 12 del puerto");
+static_assert(red_led::value(1) == red_led::mask && red_led::value(2) == 0,
+		"Un campo de un bit descarta lo que no cabe en él");
+
+/*****************************************************************************/
+
+/*
+ * Envía una cadena por la UART1
+ * @param str La cadena
+ */
+static void print_str(const char *str){
+	uart_send(UART1_ID, (char *) str, strlen(str));
+}
+
+/*****************************************************************************/
+
+/*
+ * Parpadeo del led rojo con un periodo que fija el intérprete de órdenes
+ */
+class blinker : public coroutine<256>{
+public:
+	uint32_t period = 250;		// Milisegundos
+
+private:
+	void run(){
+		gpio_set_pin_dir_output(RED_LED);
+
+		/* Sólo esta corrutina escribe en el puerto del led, así que */
+		/* basta con una lectura-modificación-escritura */
+		while(1){
+			reg_modify(LED_PORT_DATA, red_led::mask, red_led::value(1));
+			await_ms(period);
+
+			reg_modify(LED_PORT_DATA, red_led::mask, red_led::value(0));
+			await_ms(period);
+		}
+	}
+};
+
+/*****************************************************************************/
+
+/*
+ * Intérprete de órdenes por la UART1, escrito como código secuencial:
+ * 	'p' seguido de un dígito d fija el periodo de parpadeo a d * 100 ms
+ * Con callbacks sería una máquina de estados que recuerda si ya llegó la 'p'
+ */
+class command_reader : public coroutine<512>{
+public:
+	constexpr command_reader(blinker &led) : led(led) {}
+
+private:
+	blinker &led;
+
+	void run(){
+		uint8_t c;
+
+		print_str("Pulsa 'p' y un dígito\r\n");
+
+		while(1){
+			if(await_uart_byte(UART1_ID) != 'p'){
+				continue;
+			}
+
+			c = await_uart_byte(UART1_ID);
+
+			if(c >= '1' && c <= '9'){
+				led.period = (c - '0') * 100;
+				print_str("Periodo cambiado\r\n");
+			}
+			else{
+				print_str("Se esperaba un dígito entre 1 y 9\r\n");
+			}
+		}
+	}
+};
+
+/*****************************************************************************/
+
+blinker led;
+command_reader commands(led);
+coroutine_scheduler scheduler;
+
+/*****************************************************************************/
+
+/*
+ * Programa principal
+ */
 int main(int argc, char **argv) {
+	scheduler.add(led);
+	scheduler.add(commands);
+
+	/* main duerme mientras las corrutinas esperan */
+	scheduler.run();
+
 	return 0;
 }
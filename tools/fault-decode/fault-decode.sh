@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# Sistemas Empotrados
+# Simboliza un registro de fallo impreso por excep_print_fault
+#
+# Uso: fault-decode.sh <elf> [volcado]
+# Si no se indica el fichero con el volcado se lee de la entrada estándar.
+# Cada dirección del volcado que cae dentro del código de la imagen se
+# traduce a función y línea de código con addr2line
+#
+
+CROSS_COMPILE=${CROSS_COMPILE:-arm-none-eabi-}
+ADDR2LINE=${CROSS_COMPILE}addr2line
+NM=${CROSS_COMPILE}nm
+
+if [ $# -lt 1 ] || [ ! -f "$1" ]; then
+	echo "Uso: $0 <elf> [volcado]" >&2
+	exit 1
+fi
+
+ELF=$1
+DUMP=${2:-/dev/stdin}
+
+# Límites del código: desde el inicio de la imagen hasta el comienzo de .bss
+IMAGE_START=$(( 0x$($NM "$ELF" | awk '$3 == "_vector_table" { print $1 }') ))
+IMAGE_END=$(( 0x$($NM "$ELF" | awk '$3 == "_bss_start" { print $1 }') ))
+
+# Traduce una dirección si está dentro de la imagen
+symbolize(){
+	local addr=$(( $1 ))
+
+	if [ $addr -ge $IMAGE_START ] && [ $addr -lt $IMAGE_END ]; then
+		printf "    0x%08x  %s\n" $addr "$($ADDR2LINE -f -p -C -e "$ELF" $(printf "0x%x" $addr))"
+	fi
+}
+
+tr -d '\r' < "$DUMP" | while read -r line; do
+	echo "$line"
+
+	case "$line" in
+		FAULT*)
+			symbolize "$(echo "$line" | sed -n 's/.*pc=\(0x[0-9a-fA-F]*\).*/\1/p')"
+			;;
+		"REG lr="*)
+			symbolize "${line#REG lr=}"
+			;;
+		STACK*)
+			# Posibles direcciones de retorno guardadas en la pila
+			for word in $(echo "${line#*sp=0x????????}"); do
+				symbolize "$word"
+			done
+			;;
+	esac
+done
@@ -0,0 +1,526 @@
+/*
+ * Sistemas operativos empotrados
+ * Interpreta las muestras del perfilador del BSP (bsp/hal/profiler.c)
+ *
+ * Lee el flujo capturado de la UART, descarta lo que no son paquetes
+ * válidos y asocia cada pc a su función con los símbolos del ELF.
+ * Imprime un perfil plano por función, el reparto por modo del procesador,
+ * las direcciones más muestreadas con su línea de código y los puntos de
+ * llamada más frecuentes. Éstos salen del lr de las muestras en modo USR/SYS:
+ * en una función hoja es la dirección de retorno, y si cae en la propia
+ * función muestreada es un lr antiguo y se ignora.
+ *
+ * Uso: pc-profile [-n top] hello.elf captura.bin
+ * Las herramientas binutils se toman de CROSS_COMPILE (arm-none-eabi-)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+
+#define SYNC0		0xa5
+#define SYNC1		0x5a
+
+#define SAMPLE_SIZE	9
+#define MAX_LINES	64
+
+/*****************************************************************************/
+
+typedef struct{
+	uint32_t addr;
+	char *name;
+	uint32_t samples;
+} symbol_t;
+
+typedef struct{
+	uint32_t pc;
+	uint32_t samples;
+} hotspot_t;
+
+typedef struct{
+	uint32_t lr;
+	symbol_t *callee;
+	uint32_t samples;
+} callsite_t;
+
+static symbol_t *symbols;
+static uint32_t nsymbols;
+
+static hotspot_t *hotspots;
+static uint32_t nhotspots, maxhotspots;
+
+static callsite_t *callsites;
+static uint32_t ncallsites, maxcallsites;
+
+static uint32_t modes[32], thumb, total, lost, unknown, bad_packets;
+
+/*****************************************************************************/
+
+/**
+ * Retorna el prefijo de las binutils cruzadas
+ */
+static const char *cross_compile(void){
+	const char *prefix = getenv("CROSS_COMPILE");
+
+	return prefix ? prefix : "arm-none-eabi-";
+}
+
+/*****************************************************************************/
+
+/**
+ * Carga los símbolos de código del ELF, ordenados por dirección
+ */
+static int load_symbols(const char *elf){
+	char cmd[1024], line[1024], name[512];
+	uint32_t max = 0;
+	unsigned long addr;
+	char type;
+	FILE *f;
+
+	snprintf(cmd, sizeof(cmd), "%snm -n -C '%s'", cross_compile(), elf);
+
+	if((f = popen(cmd, "r")) == NULL){
+		perror("popen");
+		return -1;
+	}
+
+	while(fgets(line, sizeof(line), f)){
+		if(sscanf(line, "%lx %c %511[^\n]", &addr, &type, name) != 3){
+			continue;
+		}
+
+		if(type != 'T' && type != 't' && type != 'W' && type != 'w'){
+			continue;
+		}
+
+		/* Los símbolos de mapeo de ARM ($a, $t, $d) no son funciones */
+		if(name[0] == '$'){
+			continue;
+		}
+
+		if(nsymbols == max){
+			max = max ? max * 2 : 256;
+			symbols = realloc(symbols, max * sizeof(symbol_t));
+		}
+
+		symbols[nsymbols].addr = addr;
+		symbols[nsymbols].name = strdup(name);
+		symbols[nsymbols].samples = 0;
+		nsymbols++;
+	}
+
+	if(pclose(f) != 0 || nsymbols == 0){
+		fprintf(stderr, "pc-profile: no se pudieron leer los símbolos de %s\n", elf);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Busca la función que contiene una dirección
+ */
+static symbol_t *find_symbol(uint32_t pc){
+	int32_t lo = 0, hi = nsymbols - 1, mid;
+
+	if(nsymbols == 0 || pc < symbols[0].addr){
+		return NULL;
+	}
+
+	while(lo < hi){
+		mid = (lo + hi + 1) / 2;
+
+		if(symbols[mid].addr <= pc){
+			lo = mid;
+		}
+		else{
+			hi = mid - 1;
+		}
+	}
+
+	return &symbols[lo];
+}
+
+/*****************************************************************************/
+
+/**
+ * Registra un punto de llamada
+ */
+static void add_callsite(uint32_t lr, symbol_t *callee){
+	symbol_t *caller = find_symbol(lr);
+	uint32_t i;
+
+	if(lr == 0 || caller == NULL || callee == NULL || caller == callee){
+		return;
+	}
+
+	for(i = 0; i < ncallsites; i++){
+		if(callsites[i].lr == lr && callsites[i].callee == callee){
+			callsites[i].samples++;
+			return;
+		}
+	}
+
+	if(ncallsites == maxcallsites){
+		maxcallsites = maxcallsites ? maxcallsites * 2 : 256;
+		callsites = realloc(callsites, maxcallsites * sizeof(callsite_t));
+	}
+
+	callsites[ncallsites].lr = lr;
+	callsites[ncallsites].callee = callee;
+	callsites[ncallsites].samples = 1;
+	ncallsites++;
+}
+
+/*****************************************************************************/
+
+/**
+ * Registra una muestra
+ */
+static void add_sample(uint32_t pc, uint32_t lr, uint8_t psr){
+	symbol_t *sym = find_symbol(pc);
+	uint32_t i;
+
+	total++;
+	modes[psr & 0x1f]++;
+
+	if(psr & 0x20){
+		thumb++;
+	}
+
+	if(sym){
+		sym->samples++;
+	}
+	else{
+		unknown++;
+	}
+
+	add_callsite(lr, sym);
+
+	for(i = 0; i < nhotspots; i++){
+		if(hotspots[i].pc == pc){
+			hotspots[i].samples++;
+			return;
+		}
+	}
+
+	if(nhotspots == maxhotspots){
+		maxhotspots = maxhotspots ? maxhotspots * 2 : 256;
+		hotspots = realloc(hotspots, maxhotspots * sizeof(hotspot_t));
+	}
+
+	hotspots[nhotspots].pc = pc;
+	hotspots[nhotspots].samples = 1;
+	nhotspots++;
+}
+
+/*****************************************************************************/
+
+/**
+ * Extrae los paquetes válidos del flujo capturado
+ */
+static void parse(const uint8_t *buf, size_t len){
+	size_t pos = 0, size, i;
+	uint8_t count, sum;
+
+	while(pos + 5 <= len){
+		if(buf[pos] != SYNC0 || buf[pos + 1] != SYNC1){
+			pos++;
+			continue;
+		}
+
+		count = buf[pos + 2];
+		size = 4 + count * SAMPLE_SIZE + 1;
+
+		if(count == 0 || pos + size > len){
+			pos++;
+			continue;
+		}
+
+		for(sum = 0, i = 2; i < size - 1; i++){
+			sum += buf[pos + i];
+		}
+
+		/* Un paquete dañado (o texto que parece una cabecera) se salta */
+		if(sum != buf[pos + size - 1]){
+			bad_packets++;
+			pos++;
+			continue;
+		}
+
+		lost += buf[pos + 3];
+
+		for(i = 0; i < count; i++){
+			const uint8_t *s = &buf[pos + 4 + i * SAMPLE_SIZE];
+
+			add_sample(s[0] | s[1] << 8 | s[2] << 16 | (uint32_t) s[3] << 24,
+					s[4] | s[5] << 8 | s[6] << 16 | (uint32_t) s[7] << 24, s[8]);
+		}
+
+		pos += size;
+	}
+}
+
+/*****************************************************************************/
+
+static int by_symbol_samples(const void *a, const void *b){
+	const symbol_t *x = a, *y = b;
+
+	return (x->samples < y->samples) - (x->samples > y->samples);
+}
+
+static int by_hotspot_samples(const void *a, const void *b){
+	const hotspot_t *x = a, *y = b;
+
+	return (x->samples < y->samples) - (x->samples > y->samples);
+}
+
+static int by_callsite_samples(const void *a, const void *b){
+	const callsite_t *x = a, *y = b;
+
+	return (x->samples < y->samples) - (x->samples > y->samples);
+}
+
+/*****************************************************************************/
+
+/**
+ * Retorna el nombre de un modo del procesador
+ */
+static const char *mode_name(uint32_t mode){
+	switch(mode){
+		case 0x10: return "usr";
+		case 0x11: return "fiq";
+		case 0x12: return "irq";
+		case 0x13: return "svc";
+		case 0x17: return "abt";
+		case 0x1b: return "und";
+		case 0x1f: return "sys";
+		default: return "???";
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Obtiene el fichero y la línea de hasta MAX_LINES direcciones con una sola
+ * llamada a addr2line
+ */
+static void source_lines(const char *elf, const uint32_t *addrs, uint32_t n, char lines[][256]){
+	char cmd[1024 + 16 * MAX_LINES];
+	FILE *f = NULL;
+	uint32_t i;
+	int len;
+
+	len = snprintf(cmd, sizeof(cmd), "%saddr2line -e '%s'", cross_compile(), elf);
+
+	for(i = 0; i < n; i++){
+		len += snprintf(cmd + len, sizeof(cmd) - len, " 0x%x", addrs[i]);
+	}
+
+	if(n){
+		f = popen(cmd, "r");
+	}
+
+	for(i = 0; i < n; i++){
+		if(f == NULL || fgets(lines[i], 256, f) == NULL){
+			strcpy(lines[i], "??");
+		}
+
+		lines[i][strcspn(lines[i], "\n")] = '\0';
+	}
+
+	if(f){
+		pclose(f);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Formatea una dirección como función+desplazamiento
+ */
+static const char *where(uint32_t addr, char *buf, size_t size){
+	symbol_t *sym = find_symbol(addr);
+
+	if(sym){
+		snprintf(buf, size, "%s+0x%x", sym->name, addr - sym->addr);
+	}
+	else{
+		snprintf(buf, size, "??");
+	}
+
+	return buf;
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime las direcciones más muestreadas con su función y línea
+ */
+static void print_hotspots(const char *elf, uint32_t top){
+	static char lines[MAX_LINES][256];
+	uint32_t addrs[MAX_LINES] = { 0 };
+	char buf[512];
+	uint32_t i;
+
+	if(top > nhotspots){
+		top = nhotspots;
+	}
+
+	if(top > MAX_LINES){
+		top = MAX_LINES;
+	}
+
+	qsort(hotspots, nhotspots, sizeof(hotspot_t), by_hotspot_samples);
+
+	for(i = 0; i < top; i++){
+		addrs[i] = hotspots[i].pc;
+	}
+
+	source_lines(elf, addrs, top, lines);
+
+	printf("\nHotspots:\n");
+	printf("  samples       %%  address     function+offset                  source\n");
+
+	for(i = 0; i < top; i++){
+		printf("%9u %6.2f%%  0x%08x  %-32s %s\n", hotspots[i].samples,
+				100.0 * hotspots[i].samples / total, hotspots[i].pc,
+				where(hotspots[i].pc, buf, sizeof(buf)), lines[i]);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Imprime los puntos de llamada más frecuentes. La instrucción de llamada
+ * es la anterior a la dirección de retorno
+ */
+static void print_callsites(const char *elf, uint32_t top){
+	static char lines[MAX_LINES][256];
+	uint32_t addrs[MAX_LINES] = { 0 };
+	char buf[512];
+	uint32_t i;
+
+	if(top > ncallsites){
+		top = ncallsites;
+	}
+
+	if(top > MAX_LINES){
+		top = MAX_LINES;
+	}
+
+	qsort(callsites, ncallsites, sizeof(callsite_t), by_callsite_samples);
+
+	for(i = 0; i < top; i++){
+		addrs[i] = callsites[i].lr - 4;
+	}
+
+	source_lines(elf, addrs, top, lines);
+
+	printf("\nCall sites:\n");
+	printf("  samples       %%  callee                   caller+offset                    source\n");
+
+	for(i = 0; i < top; i++){
+		printf("%9u %6.2f%%  %-24s %-32s %s\n", callsites[i].samples,
+				100.0 * callsites[i].samples / total, callsites[i].callee->name,
+				where(addrs[i], buf, sizeof(buf)), lines[i]);
+	}
+}
+
+/*****************************************************************************/
+
+int main(int argc, char *argv[]){
+	uint32_t top = 20, i;
+	size_t len = 0, max = 0, r;
+	uint8_t *buf = NULL;
+	FILE *in;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:")) != -1){
+		if(opt == 'n'){
+			top = strtoul(optarg, NULL, 0);
+		}
+		else{
+			fprintf(stderr, "Uso: %s [-n top] hello.elf captura.bin\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(argc - optind != 2){
+		fprintf(stderr, "Uso: %s [-n top] hello.elf captura.bin\n", argv[0]);
+		return 1;
+	}
+
+	if(load_symbols(argv[optind])){
+		return 1;
+	}
+
+	in = strcmp(argv[optind + 1], "-") ? fopen(argv[optind + 1], "rb") : stdin;
+
+	if(in == NULL){
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	do{
+		if(len == max){
+			max = max ? max * 2 : 65536;
+			buf = realloc(buf, max);
+		}
+
+		r = fread(buf + len, 1, max - len, in);
+		len += r;
+	}while(r > 0);
+
+	parse(buf, len);
+
+	if(total == 0){
+		fprintf(stderr, "pc-profile: no hay muestras válidas\n");
+		return 1;
+	}
+
+	printf("%u samples, %u lost on the board, %u bad packets, %u outside known symbols\n",
+			total, lost, bad_packets, unknown);
+
+	printf("\nModes:\n");
+	for(i = 0; i < 32; i++){
+		if(modes[i]){
+			printf("  %s %9u %6.2f%%\n", mode_name(i), modes[i], 100.0 * modes[i] / total);
+		}
+	}
+	if(thumb){
+		printf("  (thumb %u)\n", thumb);
+	}
+
+	/* El perfil plano ordena una copia para poder seguir buscando en symbols */
+	{
+		symbol_t *flat = malloc(nsymbols * sizeof(symbol_t));
+
+		memcpy(flat, symbols, nsymbols * sizeof(symbol_t));
+		qsort(flat, nsymbols, sizeof(symbol_t), by_symbol_samples);
+
+		printf("\nFlat profile:\n");
+		printf("  samples       %%   cumul%%  function\n");
+
+		for(i = 0, r = 0; i < nsymbols && flat[i].samples; i++){
+			r += flat[i].samples;
+			printf("%9u %6.2f%% %7.2f%%  %s\n", flat[i].samples,
+					100.0 * flat[i].samples / total, 100.0 * r / total, flat[i].name);
+		}
+
+		free(flat);
+	}
+
+	print_hotspots(argv[optind], top);
+	print_callsites(argv[optind], top);
+
+	return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,188 @@
+/*
+ * Sistemas operativos empotrados
+ * Banco de pruebas en el host de la rueda de temporizadores del BSP
+ *
+ * Mide el coste de arrancar, detener y vencer N temporizadores con
+ * vencimientos aleatorios, y comprueba que cada uno vence en su tick.
+ * Uso: timer-wheel-bench [span]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+/*****************************************************************************/
+
+#define RUNS	5
+
+static timer_wheel_t wheel;
+static uint32_t fired, late, target;
+
+/*****************************************************************************/
+
+/**
+ * Retorna el tiempo monotónico del host en nanosegundos
+ */
+static uint64_t now_ns(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*****************************************************************************/
+
+/**
+ * Función de los temporizadores: comprueba que vence en el tick previsto y
+ * en la llamada a timer_wheel_advance de ese tick
+ */
+static void expire(void *arg){
+	timer_wheel_timer_t *timer = (timer_wheel_timer_t *) arg;
+
+	fired++;
+
+	if(wheel.now != timer->expires || target != timer->expires){
+		late++;
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Generador pseudoaleatorio sencillo (xorshift32), para que los resultados
+ * sean reproducibles
+ */
+static uint32_t rnd(void){
+	static uint32_t x = 2463534242u;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return x;
+}
+
+/*****************************************************************************/
+
+/**
+ * Ejecuta el banco de pruebas con n temporizadores
+ * @param n		Número de temporizadores
+ * @param span	Los vencimientos se reparten en [1, span] ticks
+ */
+static int bench(uint32_t n, uint32_t span){
+	timer_wheel_timer_t *timers = malloc(n * sizeof(timer_wheel_timer_t));
+	uint32_t *expires = malloc(n * sizeof(uint32_t));
+	double best_add = 1e30, best_del = 1e30, best_exp = 1e30, best_idle = 1e30;
+	uint32_t i, run, ticks = 0, wakeups = 0, next;
+	uint64_t t0, t1;
+
+	if(!timers || !expires){
+		return -1;
+	}
+
+	for(run = 0; run < RUNS; run++){
+		timer_wheel_init(&wheel, rnd());
+		fired = late = 0;
+
+		for(i = 0; i < n; i++){
+			timer_wheel_timer_init(&timers[i], expire, &timers[i]);
+			expires[i] = wheel.now + 1 + rnd() % span;
+		}
+
+		/* Arranque */
+		t0 = now_ns();
+		for(i = 0; i < n; i++){
+			timer_wheel_add(&wheel, &timers[i], expires[i]);
+		}
+		t1 = now_ns();
+		if((double) (t1 - t0) / n < best_add){
+			best_add = (double) (t1 - t0) / n;
+		}
+
+		/* Parada de la mitad y nuevo arranque */
+		t0 = now_ns();
+		for(i = 0; i < n; i += 2){
+			timer_wheel_remove(&wheel, &timers[i]);
+		}
+		t1 = now_ns();
+		if((double) (t1 - t0) / (n / 2) < best_del){
+			best_del = (double) (t1 - t0) / (n / 2);
+		}
+
+		for(i = 0; i < n; i += 2){
+			timer_wheel_add(&wheel, &timers[i], expires[i]);
+		}
+
+		/* Vencimiento tick a tick, como desde la interrupción */
+		ticks = 0;
+		t0 = now_ns();
+		while(wheel.count){
+			target = wheel.now;
+			timer_wheel_advance(&wheel, target);
+			ticks++;
+		}
+		t1 = now_ns();
+		if((double) (t1 - t0) / n < best_exp){
+			best_exp = (double) (t1 - t0) / n;
+		}
+
+		if(fired != n || late){
+			printf("ERROR: %u timers, %u fired, %u off-tick\n", n, fired, late);
+			return -1;
+		}
+
+		/* Vencimiento sin tick: sólo se despierta en el siguiente evento */
+		timer_wheel_init(&wheel, wheel.now);
+		fired = late = 0;
+
+		for(i = 0; i < n; i++){
+			timer_wheel_add(&wheel, &timers[i], wheel.now + 1 + rnd() % span);
+		}
+
+		wakeups = 0;
+		t0 = now_ns();
+		while(timer_wheel_next_expiry(&wheel, &next)){
+			target = next;
+			timer_wheel_advance(&wheel, next);
+			wakeups++;
+		}
+		t1 = now_ns();
+		if((double) (t1 - t0) / n < best_idle){
+			best_idle = (double) (t1 - t0) / n;
+		}
+
+		if(fired != n || late){
+			printf("ERROR: %u timers, %u fired, %u off-tick (tickless)\n", n, fired, late);
+			return -1;
+		}
+	}
+
+	printf("%6u timers  span %8u  add %5.1f ns  remove %5.1f ns\n", n, span, best_add, best_del);
+	printf("        periodic tick:  %8.1f ns/timer  %8u ticks\n", best_exp, ticks);
+	printf("        tickless:       %8.1f ns/timer  %8u wakeups\n", best_idle, wakeups);
+
+	free(timers);
+	free(expires);
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+int main(int argc, char *argv[]){
+	uint32_t span = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+
+	printf("timer wheel: %u levels x %u slots, %u bytes\n",
+			TIMER_WHEEL_LEVELS, TIMER_WHEEL_SLOTS, (unsigned) sizeof(timer_wheel_t));
+
+	if(bench(1000, span) || bench(10000, span)){
+		return 1;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,189 @@
+/*
+ * Sistemas operativos empotrados
+ * Prueba de estrés en el host del gestor TLSF del BSP
+ *
+ * Reserva, redimensiona y libera bloques de tamaños aleatorios comprobando
+ * que los datos no se corrompen y que los punteros están alineados. Al
+ * terminar, comprueba que la zona vuelve a ser un único bloque libre y que
+ * largest_free es exactamente la mayor petición que tlsf_malloc sirve.
+ * Uso: tlsf-stress [iteraciones]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "tlsf.h"
+
+/*****************************************************************************/
+
+#define BLOCKS		500
+#define HEAP_BYTES	90000
+
+static uint64_t heap[HEAP_BYTES / sizeof(uint64_t)];
+static tlsf_t tlsf;
+
+static uint8_t *ptrs[BLOCKS];
+static size_t sizes[BLOCKS];
+static uint8_t tags[BLOCKS];
+
+/*****************************************************************************/
+
+/**
+ * Generador pseudoaleatorio sencillo (xorshift32), para que los resultados
+ * sean reproducibles
+ */
+static uint32_t rnd(void){
+	static uint32_t x = 2463534242u;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return x;
+}
+
+/*****************************************************************************/
+
+/**
+ * Comprueba que un bloque conserva su contenido
+ * @param i		Bloque
+ * @return		Cero si está intacto
+ */
+static int check(uint32_t i){
+	size_t k;
+
+	for(k = 0; k < sizes[i]; k++){
+		if(ptrs[i][k] != tags[i]){
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Comprueba que largest_free se puede reservar y que 8 bytes más no
+ * @param where	Momento de la comprobación, para el mensaje de error
+ * @return		Cero si largest_free es exacto
+ */
+static int check_largest(const char *where){
+	tlsf_stats_t stats;
+	void *p;
+
+	tlsf_stats_get(&tlsf, &stats);
+
+	if(stats.largest_free == 0){
+		return 0;
+	}
+
+	p = tlsf_malloc(&tlsf, stats.largest_free);
+
+	if(p == NULL){
+		printf("ERROR (%s): tlsf_malloc(largest_free = %u) failed\n", where, stats.largest_free);
+		return -1;
+	}
+
+	tlsf_free(&tlsf, p);
+
+	p = tlsf_malloc(&tlsf, stats.largest_free + TLSF_ALIGN);
+
+	if(p != NULL){
+		printf("ERROR (%s): tlsf_malloc(largest_free + %u) succeeded\n", where, TLSF_ALIGN);
+		tlsf_free(&tlsf, p);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+
+int main(int argc, char **argv){
+	uint32_t iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000000;
+	uint32_t it, i, failures = 0;
+	tlsf_stats_t stats;
+	size_t size;
+	uint8_t *p;
+
+	if(tlsf_init(&tlsf, heap, sizeof(heap))){
+		printf("ERROR: tlsf_init failed\n");
+		return 1;
+	}
+
+	for(it = 0; it < iterations; it++){
+		i = rnd() % BLOCKS;
+
+		if(ptrs[i]){
+			if(check(i)){
+				printf("ERROR: block %u corrupted at iteration %u\n", i, it);
+				return 1;
+			}
+
+			if(rnd() % 3 == 0){
+				/* Redimensionado: se conserva el contenido común */
+				size = rnd() % 600;
+				p = tlsf_resize(&tlsf, ptrs[i], size);
+
+				if(p){
+					ptrs[i] = p;
+					memset(p, tags[i], size);
+					sizes[i] = size;
+				}
+
+				continue;
+			}
+
+			tlsf_free(&tlsf, ptrs[i]);
+			ptrs[i] = NULL;
+		}
+		else{
+			size = rnd() % (rnd() % 10 ? 200 : 3000);
+			p = tlsf_malloc(&tlsf, size);
+
+			if(p == NULL){
+				failures++;
+				continue;
+			}
+
+			if((uintptr_t) p & (TLSF_ALIGN - 1)){
+				printf("ERROR: misaligned block %p\n", (void *) p);
+				return 1;
+			}
+
+			ptrs[i] = p;
+			sizes[i] = size;
+			tags[i] = (uint8_t) rnd();
+			memset(p, tags[i], size);
+		}
+
+		/* largest_free con la zona fragmentada */
+		if(it % 10007 == 0 && check_largest("fragmented")){
+			return 1;
+		}
+	}
+
+	for(i = 0; i < BLOCKS; i++){
+		tlsf_free(&tlsf, ptrs[i]);
+	}
+
+	tlsf_stats_get(&tlsf, &stats);
+
+	printf("%u iterations, %u failed allocations, peak %u of %u bytes\n",
+			iterations, failures, stats.peak, stats.size);
+
+	if(stats.used != 0 || stats.free != stats.size){
+		printf("ERROR: %u bytes still used after freeing every block\n", stats.used);
+		return 1;
+	}
+
+	if(check_largest("empty")){
+		return 1;
+	}
+
+	printf("OK\n");
+
+	return 0;
+}